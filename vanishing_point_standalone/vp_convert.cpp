@@ -0,0 +1,61 @@
+/**
+ * @file vp_convert.cpp
+ * @brief Convert a video to a raw Y8 recording (see vp_raw.h) for decode-free replays
+ *
+ * usage: ./vp_convert <video> <recording.y8> [--frames N]
+ *
+ * --frames N: only the first N frames (a short clip for the ctest checks)
+ */
+
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "vp_raw.h"
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace cv;
+using namespace std;
+
+int main(int argc, char** argv)
+{
+  unsigned long max_frames = 0;
+  if (argc == 5 && !strcmp(argv[3], "--frames")) max_frames = strtoul(argv[4], NULL, 10);
+  if (argc != 3 && (argc != 5 || max_frames == 0))
+  {
+    cerr << "usage: " << argv[0] << " <video> <recording.y8> [--frames N]" << endl;
+    return 1;
+  }
+
+  VideoCapture capture(argv[1]);
+  if (!capture.isOpened())
+  {
+    cerr << "Error when reading video " << argv[1] << endl;
+    return 1;
+  }
+
+  RawRecordingWriter writer;
+  Mat frame, frame_gray;
+  unsigned long n = 0;
+  while ((max_frames == 0 || n < max_frames) && capture.read(frame))
+  {
+    // stamp from the container, the recording keeps the original timing
+    uint64_t stamp = (uint64_t) (capture.get(CV_CAP_PROP_POS_MSEC) * 1000000.0);
+    cvtColor(frame, frame_gray, COLOR_RGB2GRAY);
+    if (n == 0 && !writer.open(argv[2], frame_gray.cols, frame_gray.rows)) return 1;
+    if (!writer.write(frame_gray, stamp))
+    {
+      cerr << "Error when writing frame " << n << endl;
+      return 1;
+    }
+    n++;
+  }
+  if (n == 0 || !writer.close())
+  {
+    cerr << "Error when writing " << argv[2] << endl;
+    return 1;
+  }
+
+  cout << "Wrote " << n << " frames to " << argv[2] << endl;
+  return 0;
+}
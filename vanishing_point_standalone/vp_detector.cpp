@@ -0,0 +1,784 @@
+/**
+ * @file vp_detector.cpp
+ * @brief Vanishing point detector: canny + standard hough + ransac + lpf
+ */
+
+#include "vp_detector.h"
+#include "vp_time.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <algorithm>
+#include <math.h>
+
+using namespace cv;
+using namespace std;
+
+/* ---------------------------------- Parameters ----------------------------------*/
+// defaults are the values tuned for the standalone video
+VPParams::VPParams()
+{
+  // canny
+  lowThreshold = 60;
+  ratio = 3;
+  kernel_size = 3;
+  fused_edges = 1;
+  // hough
+  min_threshold = 50;
+  s_trackbar = 30;
+  vertical_cutoff = 10;
+  // hough controller (off by default)
+  line_band_min = 0;
+  line_band_max = 0;
+  hough_step = 2;
+  hough_min = 20;
+  hough_max = 200;
+  adapt_canny = 0;
+  canny_step = 5;
+  canny_min = 20;
+  canny_max = 100;
+  max_lines = 0;
+  // line nms
+  nms_rho = 10;
+  nms_theta = 2;
+  // ransac parameters
+  N_iterations = 50;
+  threshold_ransac = 10;
+  // voting estimator below 40 lines
+  vote_max_lines = 40;
+  vote_cell = 16;
+  vote_margin = 320;
+  // image dimensions
+  width = 640;
+  height = 480;
+  // lpf parameters
+  freq_sampling = 10;
+  freq_c = 20;
+  budget_us = 0;
+  // change detection (off by default)
+  static_threshold = 0;
+  static_max_age = 10;
+  static_width = 32;
+}
+
+/* ---------------------------------- Detector ----------------------------------*/
+VanishingPointDetector::VanishingPointDetector(const VPParams& params)
+  : params_(params)
+{
+  reset();
+}
+
+void VanishingPointDetector::reset()
+{
+  rng_ = RNG();
+  lpf_vp_.initFlag = true;
+  lpf_mid_.initFlag = true;
+
+  hough_ctrl_.threshold = params_.min_threshold + params_.s_trackbar;
+  hough_ctrl_.lowThreshold = params_.lowThreshold;
+  hough_ctrl_.n_lines = 0;
+  hough_ctrl_.step = params_.hough_step;
+  hough_ctrl_.direction = 0;
+  hough_ctrl_.saturated = false;
+  hough_ctrl_.adjustments = 0;
+
+  overloaded_ = false;
+  reused_lines_ = false;
+  have_vp_ = false;
+  s_lines_.clear();
+
+  have_result_ = false;
+  change_stats_.frames = 0;
+  change_stats_.hits = 0;
+  change_stats_.last_diff = 0;
+}
+
+// a fresh measurement, before any stage ran
+static void clearResult(VPResult& result)
+{
+  result.edge_ns = result.hough_ns = 0;
+  result.found = false;
+  result.age = 0;
+  result.quality = VP_FULL;
+  result.inliers = 0;
+  result.a_best = result.b_best = -1;
+}
+
+/* -------------------------------------- vp detection --------------------------------------------*/
+void VanishingPointDetector::detect(const Mat& frame, VPResult& result)
+{
+  uint64_t start = now_ns();
+  measure(frame, result);
+  result.total_ns = now_ns() - start;
+  result.ransac_ns = result.total_ns - result.edge_ns - result.hough_ns;
+  // remember what was measured on the signature frame for the static short-circuit
+  if (params_.static_threshold > 0 && result.age == 0)
+  {
+    last_result_ = result;
+    have_result_ = true;
+  }
+}
+
+void VanishingPointDetector::measure(const Mat& frame, VPResult& result)
+{
+  const VPParams& p = params_;
+  const bool controlled = p.line_band_max > 0;
+  const uint64_t start = now_ns();
+  const uint64_t deadline = start + 1000 * (uint64_t) p.budget_us;
+
+  // 0. scene has not changed: reuse the last result
+  if (p.static_threshold > 0 && isStatic(frame))
+  {
+    result = last_result_;
+    result.age = ++last_result_.age;
+    result.edge_ns = result.hough_ns = 0;
+    return;
+  }
+
+  clearResult(result);
+
+  // under overload skip edges + hough and reuse the previous frame's lines, at most
+  // one frame in a row so the lines never get more than a frame old
+  const bool can_reuse = p.budget_us > 0 && !reused_lines_ && !s_lines_.empty();
+  bool reuse = can_reuse && overloaded_;
+
+  if (!reuse)
+  {
+    // thresholds come from the controller when it is enabled, from the parameters otherwise
+    int lowThreshold = controlled ? hough_ctrl_.lowThreshold : p.lowThreshold;
+
+    if (p.fused_edges && p.kernel_size == 3)
+    {
+      // 1. blur + canny in one pass over row bands, same edges as below
+      canny_(frame, edges_, lowThreshold, lowThreshold*p.ratio);
+    }
+    else
+    {
+      // 1(a) Reduce noise with a kernel 3x3
+      blur( frame, edges_, Size(3,3) );
+
+      // 1(b) Apply Canny edge detector
+      Canny( edges_, edges_, lowThreshold, lowThreshold*p.ratio, p.kernel_size);
+    }
+  }
+
+  uint64_t t_edges = now_ns();
+  result.edge_ns = t_edges - start;
+
+  // out of time after the edges: the previous lines are the best we have
+  if (!reuse && can_reuse && t_edges > deadline) reuse = true;
+
+  if (!reuse)
+  {
+    // 2. Use Standard Hough Transform
+    int hough_threshold = controlled ? hough_ctrl_.threshold : p.min_threshold + p.s_trackbar;
+    HoughLines(edges_, s_lines_, 1, CV_PI/180, hough_threshold, 0, 0 );
+    filterLines();
+  }
+  else result.quality = VP_DEGRADED;
+  reused_lines_ = reuse;
+  result.hough_ns = now_ns() - t_edges;
+
+  estimate(result, deadline);
+}
+
+/* -------------------------------------- strip streaming --------------------------------------------*/
+void VanishingPointDetector::beginFrame(const Size& size)
+{
+  const VPParams& p = params_;
+  int lowThreshold = p.line_band_max > 0 ? hough_ctrl_.lowThreshold : p.lowThreshold;
+  strip_canny_.begin(size, lowThreshold, lowThreshold*p.ratio);
+  accum_.reset(size.width, size.height);
+  strip_edge_ns_ = strip_hough_ns_ = strip_total_ns_ = 0;
+}
+
+bool VanishingPointDetector::pushStrip(const Mat& strip, VPResult& result)
+{
+  const VPParams& p = params_;
+  const uint64_t start = now_ns();
+
+  // 1. edges of the rows whose neighbourhood is complete now
+  strip_edges_.clear();
+  strip_canny_.push(strip, strip_edges_);
+  const uint64_t t_edges = now_ns();
+
+  // 2. hough votes of the new edge pixels
+  for (size_t i = 0; i < strip_edges_.size(); i++) accum_.vote(strip_edges_[i].x, strip_edges_[i].y);
+  const uint64_t t_votes = now_ns();
+  strip_edge_ns_ += t_edges - start;
+  strip_hough_ns_ += t_votes - t_edges;
+  if (!strip_canny_.done())
+  {
+    strip_total_ns_ += t_votes - start;
+    return false;
+  }
+
+  // last strip: hough peaks -> lines -> estimator
+  clearResult(result);
+  int hough_threshold = p.line_band_max > 0 ? hough_ctrl_.threshold : p.min_threshold + p.s_trackbar;
+  accum_.lines(hough_threshold, s_lines_);
+  filterLines();
+  reused_lines_ = false;
+  result.edge_ns = strip_edge_ns_;
+  result.hough_ns = strip_hough_ns_ + now_ns() - t_votes;
+
+  estimate(result, start + 1000 * (uint64_t) p.budget_us);
+  result.total_ns = strip_total_ns_ + now_ns() - start;
+  result.ransac_ns = result.total_ns - result.edge_ns - result.hough_ns;
+
+  // edge image for visualization, once the result is out
+  strip_canny_.edges(edges_);
+  return true;
+}
+
+/* -------------------------------------- line filtering --------------------------------------------*/
+// hough lines -> the lines handed to the estimator
+void VanishingPointDetector::filterLines()
+{
+  const VPParams& p = params_;
+
+  //preprocessing: remove vertical lines within +-vertical_cutoff degrees
+  for (int i = static_cast<int> (s_lines_.size()) - 1; i>=0; i--)
+  {
+    int t_deg = (int) (s_lines_[i][1] * 180.0/CV_PI);
+    // it looks like theta ranges from 0 to 180 degrees
+    if (t_deg < p.vertical_cutoff || t_deg > 180 - p.vertical_cutoff)  s_lines_.erase(s_lines_.begin() + i);
+  }
+
+  // merge the clusters hough reports around every strong edge
+  suppressLines();
+
+  // pick the thresholds for the next frame from this frame's line count
+  if (p.line_band_max > 0) updateHoughController(static_cast<int>(s_lines_.size()));
+
+  // bound the ransac cost in the current frame. hough returns the lines sorted by votes
+  if (p.max_lines > 0 && static_cast<int>(s_lines_.size()) > p.max_lines)
+  {
+    s_lines_.resize(p.max_lines);
+    s_weights_.resize(p.max_lines);
+  }
+}
+
+/* -------------------------------------- estimation --------------------------------------------*/
+// ransac over lines() -> clamp, middle point, lpf. predicts when there is nothing to measure
+void VanishingPointDetector::estimate(VPResult& result, uint64_t deadline)
+{
+  const VPParams& p = params_;
+  result.n_lines = static_cast<int>(s_lines_.size());
+
+  // split the lines into 2 lists based on theta. ransac will randomly (not so random) choose 2 lines
+  // from the 2 lists respectively.
+  vector<int> lines_1, lines_2;
+  for (vector<int>::size_type i = 0; i!=s_lines_.size(); i++)
+  {
+    int t_deg = (int) (s_lines_[i][1] * 180.0/CV_PI);
+    if (t_deg < 90) lines_1.push_back(i);
+    else lines_2.push_back(i);
+  }
+
+  // 3. RANSAC if > 2 lines available
+  if (result.n_lines <= 1)
+  {
+    overloaded_ = p.budget_us > 0 && now_ns() > deadline;
+    predict(result);
+    return;
+  }
+
+  int maxInliers = 0; int a_best = -1, b_best = -1;
+  Point vp;
+  if (p.vote_max_lines > 0 && result.n_lines < p.vote_max_lines)
+  {
+    // few lines: trying every pair costs less than the random draws and cannot miss the best
+    maxInliers = voteIntersections(lines_1, lines_2, vp, a_best, b_best);
+  }
+  else
+  {
+    bool timed_out = false;
+    maxInliers = ransac(lines_1, lines_2, deadline, vp, a_best, b_best, timed_out);
+    if (timed_out) result.quality = VP_DEGRADED;
+  }
+
+  overloaded_ = p.budget_us > 0 && now_ns() > deadline;
+
+  // every sampled pair was parallel
+  if (a_best < 0)
+  {
+    predict(result);
+    return;
+  }
+
+  // limit vanishing point to be within image bounds
+  if (vp.x > p.width) vp.x = p.width;
+  if (vp.x < 0) vp.x = 0;
+  if (vp.y > p.height) vp.y = p.height;
+  if (vp.y < 0) vp.y = 0;
+
+  // compute middle point x_m
+  Point mid(computeMiddlePt(a_best, b_best, s_lines_), (int) (p.height/2.0));
+
+  // apply lpf filter over frames for vp and mid
+  Point vp_filter, mid_filter;
+  lpf(vp_filter, vp, lpf_vp_);
+  lpf(mid_filter, mid, lpf_mid_);
+
+  result.found = true;
+  result.vp = vp;
+  result.vp_filter = vp_filter;
+  result.mid = mid;
+  result.mid_filter = mid_filter;
+  // compute error signal
+  result.error = vp_filter.x - cvRound(p.width/2.0);
+  result.inliers = maxInliers;
+  result.a_best = a_best;
+  result.b_best = b_best;
+
+  have_vp_ = true;
+  last_vp_filter_ = vp_filter;
+  last_mid_filter_ = mid_filter;
+}
+
+/* -------------------------------------------- ransac ----------------------------------------------*/
+// random pairs, one line from each theta bucket (any two lines if a bucket is empty). the
+// pair whose intersection has the most inliers wins. returns the # of inliers
+int VanishingPointDetector::ransac(const vector<int>& lines_1, const vector<int>& lines_2, uint64_t deadline,
+                                   Point& vp, int& a_best, int& b_best, bool& timed_out)
+{
+  const VPParams& p = params_;
+  const int n_lines = static_cast<int>(s_lines_.size());
+  int maxInliers = 0;
+  a_best = b_best = -1;
+  for (int i = 0; i<p.N_iterations; i++)
+  {
+    // deadline hit: keep the best model so far (if any), at least one iteration runs
+    if (p.budget_us > 0 && i > 0 && now_ns() > deadline)
+    {
+      timed_out = true;
+      break;
+    }
+
+    // 1. randomly select 2 lines
+    // edit: not so random. chose lines from 2 buckets categorized according to theta
+    // if the list is not empty
+    int a,b;
+    if (!lines_1.empty() && !lines_2.empty())
+    {
+      a = lines_1[rng_.uniform(0, static_cast<int>(lines_1.size()))];
+      b = lines_2[rng_.uniform(0, static_cast<int>(lines_2.size()))];
+    } else {
+      a = rng_.uniform(0, n_lines);
+      b = rng_.uniform(0, n_lines);
+    }
+
+    // 2. find intersecting point (x_v, y_v)
+    Point intersectingPt;
+    float r_1 = s_lines_[a][0], t_1 = s_lines_[a][1];
+    float r_2 = s_lines_[b][0], t_2 = s_lines_[b][1];
+    bool found= findIntersectingPoint(r_1, t_1, r_2, t_2, intersectingPt);
+
+    // skip if not found
+    if (!found) continue;
+
+    // 3. find error for each line (shortest distance b/w point above and line: perpendicular bisector)
+    // 4. find # inliers (error < threshold)
+    int inliers = findInliers(s_lines_, intersectingPt);
+
+    // 5. if # inliers > maxInliers, save model
+    if (inliers > maxInliers)
+    {
+      maxInliers = inliers;
+      vp = intersectingPt;
+      a_best = a;
+      b_best = b;
+    }
+  } // end of ransac iterations
+
+  return maxInliers;
+}
+
+/* ------------------------------------- voting estimator ------------------------------------------*/
+// every pair of lines ransac could draw is intersected. the intersections vote into a grid of
+// vote_cell px cells over the image and vote_margin px around it (further out they land in the
+// outermost cells), weighted by the nms weights of both lines. the weighted mean of the 3x3
+// window with the most votes seeds a weighted least squares fit over the lines passing within
+// threshold_ransac of it, which gives the vp. deterministic. the best pair is the window's pair
+// closest to the vp. returns the # of inliers, 0 if all pairs were parallel
+int VanishingPointDetector::voteIntersections(const vector<int>& lines_1, const vector<int>& lines_2,
+                                              Point& vp, int& a_best, int& b_best)
+{
+  const VPParams& p = params_;
+  const int n_lines = static_cast<int>(s_lines_.size());
+  const int cell = max(1, p.vote_cell);
+  const int margin = max(0, p.vote_margin);
+  // grid coordinates: image shifted by the margin
+  const int grid_w = p.width + 2*margin, grid_h = p.height + 2*margin;
+  const int grid_cols = grid_w / cell + 1, grid_rows = grid_h / cell + 1;
+  a_best = b_best = -1;
+
+  vector<double> cos_t(n_lines), sin_t(n_lines);
+  for (int i = 0; i < n_lines; i++)
+  {
+    cos_t[i] = cos(s_lines_[i][1]);
+    sin_t[i] = sin(s_lines_[i][1]);
+  }
+
+  // 1. all intersections, across the buckets (or all pairs if one is empty)
+  intersections_.clear();
+  const bool split = !lines_1.empty() && !lines_2.empty();
+  const int n_1 = split ? static_cast<int>(lines_1.size()) : n_lines;
+  for (int i = 0; i < n_1; i++)
+  {
+    const int a = split ? lines_1[i] : i;
+    const int n_2 = split ? static_cast<int>(lines_2.size()) : n_lines;
+    for (int j = split ? 0 : i + 1; j < n_2; j++)
+    {
+      const int b = split ? lines_2[j] : j;
+      double determinant = cos_t[a]*sin_t[b] - cos_t[b]*sin_t[a];
+      if (fabs(determinant) < 1e-6) continue; // parallel
+      double x = (sin_t[b]*s_lines_[a][0] - sin_t[a]*s_lines_[b][0]) / determinant;
+      double y = (cos_t[a]*s_lines_[b][0] - cos_t[b]*s_lines_[a][0]) / determinant;
+      // to grid coordinates, intersections beyond the margin vote in the outermost cells
+      x = min(max(x + margin, 0.0), (double) grid_w);
+      y = min(max(y + margin, 0.0), (double) grid_h);
+
+      Intersection it;
+      it.x = (float) x;
+      it.y = (float) y;
+      it.w = s_weights_[a] * s_weights_[b];
+      it.a = a;
+      it.b = b;
+      intersections_.push_back(it);
+    }
+  }
+  if (intersections_.empty()) return 0;
+
+  // 2. votes, best 3x3 window (first one on ties)
+  vote_grid_.assign(grid_cols * grid_rows, 0.f);
+  for (size_t k = 0; k < intersections_.size(); k++)
+  {
+    const Intersection& it = intersections_[k];
+    vote_grid_[(int) (it.y / cell) * grid_cols + (int) (it.x / cell)] += it.w;
+  }
+  // windows are only scored around cells that got votes
+  int best_col = 0, best_row = 0;
+  float best_votes = -1;
+  for (size_t k = 0; k < intersections_.size(); k++)
+  {
+    const int c = (int) (intersections_[k].x / cell), r = (int) (intersections_[k].y / cell);
+    float votes = 0;
+    for (int rr = max(r - 1, 0); rr <= min(r + 1, grid_rows - 1); rr++)
+      for (int cc = max(c - 1, 0); cc <= min(c + 1, grid_cols - 1); cc++)
+        votes += vote_grid_[rr * grid_cols + cc];
+    if (votes > best_votes || (votes == best_votes && r * grid_cols + c < best_row * grid_cols + best_col))
+    {
+      best_votes = votes;
+      best_col = c;
+      best_row = r;
+    }
+  }
+
+  // seed: weighted mean of the window's intersections
+  double sum_x = 0, sum_y = 0, sum_w = 0;
+  for (size_t k = 0; k < intersections_.size(); k++)
+  {
+    const Intersection& it = intersections_[k];
+    if (abs((int) (it.x / cell) - best_col) > 1 || abs((int) (it.y / cell) - best_row) > 1) continue;
+    sum_x += it.w * it.x;
+    sum_y += it.w * it.y;
+    sum_w += it.w;
+  }
+  double x = sum_x / sum_w - margin, y = sum_y / sum_w - margin;
+
+  // 3. weighted least squares over the supporting lines: min sum w (x cos t + y sin t - r)^2
+  double sxx = 0, sxy = 0, syy = 0, bx = 0, by = 0;
+  for (int i = 0; i < n_lines; i++)
+  {
+    const double r = s_lines_[i][0], w = s_weights_[i];
+    if (fabs(cos_t[i]*x + sin_t[i]*y - r) >= p.threshold_ransac) continue;
+    sxx += w * cos_t[i]*cos_t[i];
+    sxy += w * cos_t[i]*sin_t[i];
+    syy += w * sin_t[i]*sin_t[i];
+    bx += w * r*cos_t[i];
+    by += w * r*sin_t[i];
+  }
+  // the supporting lines can all be (nearly) parallel: keep the seed then
+  double determinant = sxx*syy - sxy*sxy;
+  if (determinant > 1e-6 * (sxx + syy) * (sxx + syy))
+  {
+    x = (syy*bx - sxy*by) / determinant;
+    y = (sxx*by - sxy*bx) / determinant;
+  }
+  vp = Point(cvRound(x), cvRound(y));
+
+  // best pair for the middle point and the overlay
+  double best_d = -1;
+  for (size_t k = 0; k < intersections_.size(); k++)
+  {
+    const Intersection& it = intersections_[k];
+    if (abs((int) (it.x / cell) - best_col) > 1 || abs((int) (it.y / cell) - best_row) > 1) continue;
+    double dx = it.x - margin - x, dy = it.y - margin - y;
+    double d = dx*dx + dy*dy;
+    if (best_d < 0 || d < best_d)
+    {
+      best_d = d;
+      a_best = it.a;
+      b_best = it.b;
+    }
+  }
+
+  return findInliers(s_lines_, vp);
+}
+
+/* -------------------------------------- change detection --------------------------------------------*/
+// cheap similarity check: mean abs difference between the downsampled frame and the
+// downsampled frame the last result was measured on. the reference is only replaced when
+// the scene changed (or the result got too old) so slow drift is not hidden frame by frame
+bool VanishingPointDetector::isStatic(const Mat& frame)
+{
+  const VPParams& p = params_;
+  int w = min(p.static_width, frame.cols);
+  resize(frame, small_, Size(w, max(1, frame.rows * w / frame.cols)), 0, 0, INTER_AREA);
+  change_stats_.frames++;
+
+  if (have_result_ && last_result_.age < p.static_max_age && small_.size() == signature_.size()
+      && small_.type() == signature_.type())
+  {
+    Mat diff;
+    absdiff(small_, signature_, diff);
+    change_stats_.last_diff = mean(diff)[0];
+    if (change_stats_.last_diff < p.static_threshold)
+    {
+      change_stats_.hits++;
+      return true;
+    }
+  }
+  else change_stats_.last_diff = -1;
+
+  small_.copyTo(signature_);
+  return false;
+}
+
+/* -------------------------------------- prediction --------------------------------------------*/
+// no measurement on this frame: hold the last filtered vp (image center if there is none yet)
+// so an error is still output every frame
+void VanishingPointDetector::predict(VPResult& result) const
+{
+  const VPParams& p = params_;
+  Point center(cvRound(p.width/2.0), cvRound(p.height/2.0));
+  result.found = false;
+  result.quality = VP_PREDICTED;
+  result.vp = result.vp_filter = have_vp_ ? last_vp_filter_ : center;
+  result.mid = result.mid_filter = have_vp_ ? last_mid_filter_ : center;
+  result.error = result.vp_filter.x - center.x;
+  result.inliers = 0;
+  result.a_best = result.b_best = -1;
+}
+
+/* ------------------------------------------ line nms --------------------------------------------*/
+// hough lines come sorted by votes. every line not yet merged seeds a cluster, and the
+// lines within nms_rho/nms_theta of the seed are merged into it: the representative is
+// the mean of the cluster, its weight the cluster size. the candidates of a seed are found
+// by binary search in a theta sorted copy, so this is O(n log n) unless the lines pile up
+// in one theta window. representatives keep the seed order (strongest first).
+// theta wrap around at 0/180 is ignored, those lines are removed as vertical before.
+struct ThetaLess
+{
+  const vector<Vec2f>& lines;
+  ThetaLess(const vector<Vec2f>& l) : lines(l) {}
+  bool operator()(int a, int b) const { return lines[a][1] < lines[b][1]; }
+  bool operator()(int a, float t) const { return lines[a][1] < t; }
+  bool operator()(float t, int b) const { return t < lines[b][1]; }
+};
+
+void VanishingPointDetector::suppressLines()
+{
+  const VPParams& p = params_;
+  const int n = static_cast<int>(s_lines_.size());
+  if (p.nms_rho <= 0 || n < 2)
+  {
+    s_weights_.assign(n, 1.0f);
+    return;
+  }
+  const float tol_theta = p.nms_theta * CV_PI/180;
+
+  vector<int> by_theta(n);
+  for (int i = 0; i < n; i++) by_theta[i] = i;
+  ThetaLess less(s_lines_);
+  sort(by_theta.begin(), by_theta.end(), less);
+
+  vector<bool> merged(n, false);
+  vector<Vec2f> reps;
+  s_weights_.clear();
+  for (int i = 0; i < n; i++)
+  {
+    if (merged[i]) continue;
+    const float r = s_lines_[i][0], t = s_lines_[i][1];
+    double sum_r = 0, sum_t = 0;
+    int count = 0;
+
+    vector<int>::iterator it = lower_bound(by_theta.begin(), by_theta.end(), t - tol_theta, less);
+    vector<int>::iterator end = upper_bound(by_theta.begin(), by_theta.end(), t + tol_theta, less);
+    for (; it != end; ++it)
+    {
+      int j = *it;
+      if (merged[j] || fabs(s_lines_[j][0] - r) > p.nms_rho) continue;
+      merged[j] = true;
+      sum_r += s_lines_[j][0];
+      sum_t += s_lines_[j][1];
+      count++;
+    }
+
+    reps.push_back(Vec2f(sum_r / count, sum_t / count));
+    s_weights_.push_back(count);
+  }
+  s_lines_.swap(reps);
+}
+
+/* ----------------------------------- hough controller ------------------------------------------*/
+// closed loop control of the line count: raise the hough threshold when there are too many
+// lines, lower it when there are too few. the step doubles while the count stays out of band
+// on the same side and resets once it is back in band. when the hough threshold saturates
+// the canny low threshold is moved instead (if adapt_canny).
+void VanishingPointDetector::updateHoughController(int n_lines)
+{
+  const VPParams& p = params_;
+  HoughControllerState& c = hough_ctrl_;
+  c.n_lines = n_lines;
+
+  int direction = 0;
+  if (n_lines > p.line_band_max) direction = 1;
+  else if (n_lines < p.line_band_min) direction = -1;
+
+  if (direction == 0)
+  {
+    c.direction = 0;
+    c.step = p.hough_step;
+    c.saturated = false;
+    return;
+  }
+
+  if (direction == c.direction) c.step = min(c.step * 2, p.hough_max - p.hough_min);
+  else c.step = p.hough_step;
+  c.direction = direction;
+
+  int threshold = min(max(c.threshold + direction * c.step, p.hough_min), p.hough_max);
+  int lowThreshold = c.lowThreshold;
+  if (threshold == c.threshold && p.adapt_canny)
+    lowThreshold = min(max(c.lowThreshold + direction * p.canny_step, p.canny_min), p.canny_max);
+
+  c.saturated = threshold == c.threshold && lowThreshold == c.lowThreshold;
+  if (!c.saturated) c.adjustments++;
+  c.threshold = threshold;
+  c.lowThreshold = lowThreshold;
+}
+
+/* -------------------------------------- findIntersectingPt --------------------------------------------*/
+// find intersecting point between two lines using crammer's rule.
+// if no intersecting point (parallel lines/same line) return false
+// i/p: lines: [rho_1;theta_1] & [rho_2;theta_2] and intersectingPt
+bool VanishingPointDetector::findIntersectingPoint(float r_1, float t_1, float r_2, float t_2, Point& intersectingPt) const
+{
+  double determinant = (cos(t_1) * sin(t_2)) - (cos(t_2) * sin(t_1));
+  if (determinant != 0) {
+    intersectingPt.x = (int) (sin(t_2)*r_1 - sin(t_1)*r_2) / determinant;
+    intersectingPt.y = (int) (cos(t_1)*r_2 - cos(t_2)*r_1) / determinant;
+    return true;
+  }
+  // else no point found (parallel lines/same line)
+  return false;
+}
+
+/* ------------------------------------------findInliers --------------------------------------------*/
+int VanishingPointDetector::findInliers(const vector<Vec2f>& s_lines, const Point& intersectingPt) const
+{
+  int inliers = 0;
+  for (int i = 0; i < static_cast<int>(s_lines.size()); i++) {
+    // find error: shortest distance between intersectingPt and line
+    float r = s_lines[i][0], t = s_lines[i][1];
+    double a = cos(t), b = sin(t);
+    int x = intersectingPt.x, y = intersectingPt.y;
+    double d = fabs(a*x + b*y - r) / sqrt(pow(a,2) + pow(b,2));
+
+    // find inliers
+    if (d < params_.threshold_ransac) { inliers++; }
+  }
+  return inliers;
+}
+
+/* ------------------------------------- middle point ------------------------------------------*/
+// Takes in the 2 best lines and computes the middle point between the intersection of those lines with the x-axis
+int VanishingPointDetector::computeMiddlePt(int a_best, int b_best, const vector<Vec2f>& s_lines) const
+{
+  const int width = params_.width, height = params_.height;
+
+  // corner case: take care of a_best / b_best out of bounds
+  if (a_best < 0 || a_best >= static_cast<int>(s_lines.size()) || b_best < 0 || b_best >= static_cast<int>(s_lines.size()))
+  {
+    return (int) (width/2.0);
+  }
+
+  Point intersectingPt;
+  float r_1, t_1, r_2, t_2;
+  int x1, x2;
+  bool found;
+  r_1 = s_lines[a_best][0]; t_1 = s_lines[a_best][1]; // 1st line
+  r_2 = height/2.0; t_2 = CV_PI/2; // horizontal line
+
+  found = findIntersectingPoint(r_1, t_1, r_2, t_2, intersectingPt);
+  // if intersecting point not found set it at the left border of the image
+  if (found)
+  {
+    x1 = intersectingPt.x;
+    // limit
+    if (x1<0) x1 = 0;
+    if (x1>width) x1 = width;
+  }
+  else
+  {
+    if (t_1 * 180/CV_PI < 90 ) { x1 = 0; }
+    else { x1 = width; }
+  }
+
+  r_1 = s_lines[b_best][0]; t_1 = s_lines[b_best][1]; // 2nd line
+  found= findIntersectingPoint(r_1, t_1, r_2, t_2, intersectingPt);
+  // if intersecting point not found set it at the right border of the image
+  if (found)
+  {
+    x2 = intersectingPt.x;
+    // limit
+    if (x2<0) x2 = 0;
+    if (x2>width) x2 = width;
+  }
+  else
+  {
+    if (t_1 * 180/CV_PI < 90 ) { x2 = 0; }
+    else { x2 = width; }
+  }
+
+  int x_m = (int) (x1 + x2)/2.0;
+  // limit within bounds
+  if (x_m > width) x_m = width;
+  if (x_m < 0) x_m = 0;
+
+  return x_m;
+}
+
+/* ---------------------1st order LPF (discretized using tustin approx)--------------------------*/
+// input vp gets filtered and saved in vp_filter
+// int freq_sampling | int freq_c
+void VanishingPointDetector::lpf(Point& vp_filter, const Point& vp, LPFState& s) const
+{
+  // first time initialization
+  if (s.initFlag)
+  {
+    vp_filter = vp;
+    s.prev = vp;
+    s.filter_prev = vp;
+    s.initFlag = false;
+    return;
+  }
+
+  float Tw = 1.0/params_.freq_sampling * 2.0 * CV_PI * params_.freq_c;
+  vp_filter.x = (int) ((Tw*(vp.x + s.prev.x) - (Tw-2)*s.filter_prev.x)/(Tw+2));
+  vp_filter.y = (int) ((Tw*(vp.y + s.prev.y) - (Tw-2)*s.filter_prev.y)/(Tw+2));
+
+  s.prev = vp;
+  s.filter_prev = vp_filter;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file vp_detector.h
+ * @brief Vanishing point detector shared by the video loop and the tools
+ */
+
+#ifndef VP_DETECTOR_H
+#define VP_DETECTOR_H
+
+#include "opencv2/core/core.hpp"
+#include "vp_edges.h"
+#include "vp_hough.h"
+#include <stdint.h>
+#include <vector>
+
+/* ---------------------------------- Parameters ----------------------------------*/
+struct VPParams
+{
+  // canny
+  int lowThreshold;
+  int ratio;
+  int kernel_size;
+  int fused_edges; // if != 0 and kernel_size == 3, blur + canny run as one fused kernel (vp_edges.h)
+  // hough: vote threshold is min_threshold + s_trackbar
+  int min_threshold;
+  int s_trackbar;
+  // hough threshold controller: adjusts the vote threshold each frame to keep the
+  // line count within [line_band_min, line_band_max]. disabled if line_band_max == 0
+  int line_band_min;
+  int line_band_max;
+  int hough_step; // initial threshold correction, doubles while the count stays out of band
+  int hough_min, hough_max; // threshold limits
+  int adapt_canny; // if != 0, move lowThreshold by canny_step once the hough threshold saturates
+  int canny_step;
+  int canny_min, canny_max;
+  int max_lines; // hard cap on lines handed to ransac (strongest kept), 0 = no cap
+  // line nms: lines within nms_rho px and nms_theta degrees of a stronger line are merged
+  // into it. disabled if nms_rho == 0
+  int nms_rho;
+  int nms_theta;
+  // preprocessing: lines within +-vertical_cutoff degrees of vertical are removed
+  int vertical_cutoff;
+  // ransac parameters
+  int N_iterations; // # of iterations for ransac
+  int threshold_ransac; // distance within which the hypothesis is classified as an inlier
+  // voting estimator: with fewer than vote_max_lines lines, every pair of lines is intersected
+  // and voted into a grid of vote_cell px cells instead of ransac, the best cell is refined
+  // by weighted least squares over its lines. 0 = always ransac. the grid reaches vote_margin px
+  // past each image border (the vp is clamped afterwards, as with ransac), intersections further
+  // out vote in the outermost cells
+  int vote_max_lines;
+  int vote_cell;
+  int vote_margin;
+  // image dimensions
+  int width;
+  int height;
+  // lpf parameters
+  int freq_sampling;
+  int freq_c;
+  // per-frame time budget in microseconds, 0 = run every stage to completion
+  int budget_us;
+  // change detection: if the downsampled frame differs from the one the last result was
+  // measured on by less than static_threshold gray levels (mean abs), the result is reused
+  // for up to static_max_age frames. disabled if static_threshold == 0
+  int static_threshold;
+  int static_max_age;
+  int static_width; // width of the downsampled signature
+
+  VPParams();
+};
+
+/* ---------------------------------- Result ----------------------------------*/
+enum VPQuality
+{
+  VP_FULL = 0, // every stage ran to completion on this frame
+  VP_DEGRADED = 1, // measured, but ransac was cut short or the previous frame's lines were reused
+  VP_PREDICTED = 2 // no measurement, vp/mid/error hold the last filtered values
+};
+
+struct VPResult
+{
+  bool found; // false if there is no measurement on this frame (quality == VP_PREDICTED)
+  VPQuality quality;
+  cv::Point vp, vp_filter; // raw and low pass filtered vanishing point
+  cv::Point mid, mid_filter; // middle point between the best pair on the horizontal center line
+  int error; // vp_filter.x - center_x
+  int inliers;
+  int a_best, b_best; // indices of the best pair of lines in lines()
+  int n_lines; // # of lines after preprocessing
+  int age; // # of frames this result has been reused for, 0 if measured on this frame
+  // time spent in each stage on this frame (ns). ransac_ns includes the filtering
+  uint64_t edge_ns, hough_ns, ransac_ns, total_ns;
+};
+
+/* ---------------------------------- Hough controller ----------------------------------*/
+// state of the closed loop hough threshold controller, for monitoring
+struct HoughControllerState
+{
+  int threshold; // hough vote threshold used for the next frame
+  int lowThreshold; // canny low threshold used for the next frame
+  int n_lines; // line count seen on the last frame
+  int step; // current correction step
+  int direction; // +1 raising, -1 lowering, 0 in band
+  bool saturated; // threshold hit hough_min/hough_max and canny could not help
+  unsigned long adjustments; // # of frames on which a threshold was changed
+};
+
+/* ---------------------------------- Change detection ----------------------------------*/
+// counters of the static frame short-circuit
+struct ChangeDetectorStats
+{
+  unsigned long frames; // # of frames checked
+  unsigned long hits; // # of frames that reused the previous result
+  double last_diff; // mean abs difference of the last checked frame
+  double hitRate() const { return frames ? (double) hits / frames : 0; }
+};
+
+/* ---------------------------------- Detector ----------------------------------*/
+// holds all per-stream state (filters, random generator) so several detectors
+// can run side by side, e.g. one per configuration in vp_sweep
+class VanishingPointDetector
+{
+public:
+  explicit VanishingPointDetector(const VPParams& params = VPParams());
+
+  // run edges -> hough -> ransac -> filtering on an 8-bit frame. always fills result,
+  // with a prediction if no vanishing point could be measured within the budget
+  void detect(const cv::Mat& frame, VPResult& result);
+  // strip streaming, for cameras that deliver a frame progressively (rolling shutter):
+  // beginFrame(), then pushStrip() with consecutive rows from the top. edges and hough
+  // votes are computed as the strips come in, the last strip extracts the lines, runs
+  // the estimator and fills result (returns true). the budget counts from the last
+  // strip, change detection and line reuse do not apply
+  void beginFrame(const cv::Size& size);
+  bool pushStrip(const cv::Mat& strip, VPResult& result);
+  // forget the filter history (e.g. when switching to another video)
+  void reset();
+
+  VPParams& params() { return params_; }
+  const VPParams& params() const { return params_; }
+  // intermediate results of the last detect() call, for visualization
+  const cv::Mat& edges() const { return edges_; }
+  const std::vector<cv::Vec2f>& lines() const { return s_lines_; }
+  // # of hough lines merged into each of lines()
+  const std::vector<float>& weights() const { return s_weights_; }
+  const HoughControllerState& houghController() const { return hough_ctrl_; }
+  const ChangeDetectorStats& changeStats() const { return change_stats_; }
+
+private:
+  // 1st order lpf state, one per filtered signal
+  struct LPFState
+  {
+    cv::Point prev, filter_prev;
+    bool initFlag;
+  };
+
+  bool findIntersectingPoint(float, float, float, float, cv::Point&) const;
+  int findInliers(const std::vector<cv::Vec2f>&, const cv::Point&) const;
+  int ransac(const std::vector<int>&, const std::vector<int>&, uint64_t, cv::Point&, int&, int&, bool&);
+  int voteIntersections(const std::vector<int>&, const std::vector<int>&, cv::Point&, int&, int&);
+  int computeMiddlePt(int, int, const std::vector<cv::Vec2f>&) const;
+  void lpf(cv::Point&, const cv::Point&, LPFState&) const;
+  void updateHoughController(int);
+  void suppressLines();
+  void filterLines();
+  void measure(const cv::Mat&, VPResult&);
+  void estimate(VPResult&, uint64_t deadline);
+  void predict(VPResult&) const;
+  bool isStatic(const cv::Mat&);
+
+  VPParams params_;
+  cv::Mat edges_;
+  FusedCanny canny_;
+  // strip streaming state
+  StripCanny strip_canny_;
+  HoughAccumulator accum_;
+  std::vector<cv::Point> strip_edges_; // pixels that became edges in the last strip
+  uint64_t strip_edge_ns_, strip_hough_ns_, strip_total_ns_;
+  std::vector<cv::Vec2f> s_lines_;
+  std::vector<float> s_weights_;
+  cv::RNG rng_;
+  // voting estimator scratch
+  struct Intersection
+  {
+    float x, y, w; // point in grid coordinates (image + vote_margin), vote weight
+    int a, b; // line indices
+  };
+  std::vector<Intersection> intersections_;
+  std::vector<float> vote_grid_;
+  LPFState lpf_vp_, lpf_mid_;
+  HoughControllerState hough_ctrl_;
+  // anytime state
+  bool overloaded_; // the last frame ran over budget
+  bool reused_lines_; // the last frame reused the lines of the frame before
+  bool have_vp_; // a filtered vp is available for predictions
+  cv::Point last_vp_filter_, last_mid_filter_;
+  // change detection state
+  cv::Mat signature_, small_; // downsampled reference frame of last_result_, scratch
+  VPResult last_result_;
+  bool have_result_;
+  ChangeDetectorStats change_stats_;
+};
+
+#endif // VP_DETECTOR_H
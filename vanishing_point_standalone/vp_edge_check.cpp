@@ -0,0 +1,110 @@
+/**
+ * @file vp_edge_check.cpp
+ * @brief Check the fused edge kernel (vp_edges.h) against blur + Canny on recorded footage
+ *
+ * usage: ./vp_edge_check <video|recording.y8> [--tolerance F] [--ratio N]
+ *
+ * every frame goes through both paths at a few canny thresholds. exits with 1 if the
+ * fraction of differing pixels on any frame exceeds the tolerance (default 0.001).
+ */
+
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "vp_edges.h"
+#include "vp_raw.h"
+#include "vp_time.h"
+#include <iostream>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace cv;
+using namespace std;
+
+int main(int argc, char** argv)
+{
+  string filename;
+  double tolerance = 0.001;
+  int ratio = 3;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = atof(argv[++i]);
+    else if (!strcmp(argv[i], "--ratio") && i + 1 < argc) ratio = atoi(argv[++i]);
+    else filename = argv[i];
+  }
+  if (filename.empty())
+  {
+    cerr << "usage: " << argv[0] << " <video|recording.y8> [--tolerance F] [--ratio N]" << endl;
+    return 1;
+  }
+
+  VideoCapture capture;
+  RawFrameSource raw;
+  bool use_raw = isRawRecording(filename);
+  if (use_raw ? !raw.open(filename) : !capture.open(filename))
+  {
+    cerr << "Error when reading " << filename << endl;
+    return 1;
+  }
+
+  // canny low thresholds around the tuned ones (standalone 60, controller range 20..100)
+  const int thresholds[] = { 20, 40, 60, 100 };
+  const int n_thresholds = sizeof(thresholds)/sizeof(thresholds[0]);
+
+  FusedCanny fused;
+  Mat frame, frame_gray, blurred, reference, edges;
+  uint64_t t_reference = 0, t_fused = 0;
+  double worst = 0;
+  unsigned long n = 0, failed = 0;
+  while (true)
+  {
+    if (use_raw)
+    {
+      uint64_t stamp;
+      if (!raw.read(frame_gray, stamp)) break;
+    }
+    else
+    {
+      if (!capture.read(frame)) break;
+      cvtColor(frame, frame_gray, COLOR_RGB2GRAY);
+    }
+
+    for (int k = 0; k < n_thresholds; k++)
+    {
+      int low = thresholds[k];
+      uint64_t t0 = now_ns();
+      blur(frame_gray, blurred, Size(3,3));
+      Canny(blurred, reference, low, low*ratio, 3);
+      uint64_t t1 = now_ns();
+      fused(frame_gray, edges, low, low*ratio);
+      uint64_t t2 = now_ns();
+      t_reference += t1 - t0;
+      t_fused += t2 - t1;
+
+      double mismatch = edgeMismatch(reference, edges);
+      if (mismatch > worst) worst = mismatch;
+      if (mismatch > tolerance)
+      {
+        cout << "frame " << n << " canny " << low << ": " << 100.0 * mismatch << "% of the pixels differ" << endl;
+        failed++;
+      }
+    }
+    n++;
+  }
+  if (n == 0)
+  {
+    cerr << "No frames in " << filename << endl;
+    return 1;
+  }
+
+  unsigned long runs = n * n_thresholds;
+  cout << "Frames: " << n << " | worst mismatch: " << 100.0 * worst << "% | tolerance: " << 100.0 * tolerance << "%" << endl;
+  cout << "blur + Canny: " << t_reference / runs / 1000 << " us | fused: " << t_fused / runs / 1000 << " us" << endl;
+  if (failed)
+  {
+    cout << "FAILED: " << failed << "/" << runs << " runs over the tolerance" << endl;
+    return 1;
+  }
+  cout << "OK" << endl;
+  return 0;
+}
@@ -0,0 +1,427 @@
+/**
+ * @file vp_edges.cpp
+ * @brief Fused edge kernel: 3x3 box blur + sobel + canny in one pass over row bands
+ */
+
+#include "vp_edges.h"
+#include <algorithm>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace cv;
+using namespace std;
+
+// tan(22.5 deg) in fixed point, the same constants canny uses
+#define CANNY_SHIFT 15
+static const int TG22 = (int) (0.4142135623730950488016887242097*(1 << CANNY_SHIFT) + 0.5);
+
+/* ---------------------------------- rows ----------------------------------*/
+// source rows above and below y with reflect 101 borders, like blur()
+static inline int rowAbove(int y, int rows) { return y > 0 ? y - 1 : min(1, rows - 1); }
+static inline int rowBelow(int y, int rows) { return y < rows - 1 ? y + 1 : max(rows - 2, 0); }
+
+// blurred row of source row b (a above, c below) into dst[0 .. cols-1], 3x3 box.
+// dst[-1] and dst[cols] get the replicated ends the sobel needs
+static void blurRow(const uchar* a, const uchar* b, const uchar* c, int cols, short* dst, ushort* vsum)
+{
+  // vertical sums
+  int x = 0;
+#if defined __SSE2__
+  const __m128i z = _mm_setzero_si128();
+  for (; x <= cols - 16; x += 16)
+  {
+    __m128i va = _mm_loadu_si128((const __m128i*) (a + x));
+    __m128i vb = _mm_loadu_si128((const __m128i*) (b + x));
+    __m128i vc = _mm_loadu_si128((const __m128i*) (c + x));
+    __m128i lo = _mm_add_epi16(_mm_add_epi16(_mm_unpacklo_epi8(va, z), _mm_unpacklo_epi8(vb, z)), _mm_unpacklo_epi8(vc, z));
+    __m128i hi = _mm_add_epi16(_mm_add_epi16(_mm_unpackhi_epi8(va, z), _mm_unpackhi_epi8(vb, z)), _mm_unpackhi_epi8(vc, z));
+    _mm_storeu_si128((__m128i*) (vsum + x), lo);
+    _mm_storeu_si128((__m128i*) (vsum + x + 8), hi);
+  }
+#endif
+  for (; x < cols; x++) vsum[x] = a[x] + b[x] + c[x];
+  vsum[-1] = vsum[cols > 1 ? 1 : 0];
+  vsum[cols] = vsum[cols > 1 ? cols - 2 : 0];
+
+  // horizontal sums, rounded: (s + 4) / 9 == (s + 4) * 7282 >> 16 for every s <= 9*255
+  x = 0;
+#if defined __SSE2__
+  const __m128i four = _mm_set1_epi16(4), div9 = _mm_set1_epi16(7282);
+  for (; x <= cols - 8; x += 8)
+  {
+    __m128i s = _mm_add_epi16(_mm_add_epi16(_mm_loadu_si128((const __m128i*) (vsum + x - 1)),
+                                            _mm_loadu_si128((const __m128i*) (vsum + x))),
+                              _mm_loadu_si128((const __m128i*) (vsum + x + 1)));
+    _mm_storeu_si128((__m128i*) (dst + x), _mm_mulhi_epu16(_mm_add_epi16(s, four), div9));
+  }
+#endif
+  for (; x < cols; x++) dst[x] = (short) ((vsum[x - 1] + vsum[x] + vsum[x + 1] + 4) / 9);
+  dst[-1] = dst[0];
+  dst[cols] = dst[cols - 1];
+}
+
+// 3x3 sobel gradients and L1 magnitude of blurred row b (a above, c below).
+// mag[-1] and mag[cols] are 0 for the suppression
+static void sobelRow(const short* a, const short* b, const short* c, int cols, short* dx, short* dy, short* mag)
+{
+  int x = 0;
+#if defined __SSE2__
+  const __m128i z = _mm_setzero_si128();
+  for (; x <= cols - 8; x += 8)
+  {
+    __m128i a0 = _mm_loadu_si128((const __m128i*) (a + x - 1));
+    __m128i a1 = _mm_loadu_si128((const __m128i*) (a + x));
+    __m128i a2 = _mm_loadu_si128((const __m128i*) (a + x + 1));
+    __m128i b0 = _mm_loadu_si128((const __m128i*) (b + x - 1));
+    __m128i b2 = _mm_loadu_si128((const __m128i*) (b + x + 1));
+    __m128i c0 = _mm_loadu_si128((const __m128i*) (c + x - 1));
+    __m128i c1 = _mm_loadu_si128((const __m128i*) (c + x));
+    __m128i c2 = _mm_loadu_si128((const __m128i*) (c + x + 1));
+    __m128i gx = _mm_add_epi16(_mm_add_epi16(_mm_sub_epi16(a2, a0), _mm_sub_epi16(c2, c0)),
+                               _mm_slli_epi16(_mm_sub_epi16(b2, b0), 1));
+    __m128i gy = _mm_sub_epi16(_mm_add_epi16(_mm_add_epi16(c0, c2), _mm_slli_epi16(c1, 1)),
+                               _mm_add_epi16(_mm_add_epi16(a0, a2), _mm_slli_epi16(a1, 1)));
+    _mm_storeu_si128((__m128i*) (dx + x), gx);
+    _mm_storeu_si128((__m128i*) (dy + x), gy);
+    _mm_storeu_si128((__m128i*) (mag + x), _mm_add_epi16(_mm_max_epi16(gx, _mm_sub_epi16(z, gx)),
+                                                          _mm_max_epi16(gy, _mm_sub_epi16(z, gy))));
+  }
+#endif
+  for (; x < cols; x++)
+  {
+    int gx = (a[x + 1] - a[x - 1]) + 2*(b[x + 1] - b[x - 1]) + (c[x + 1] - c[x - 1]);
+    int gy = (c[x - 1] + 2*c[x] + c[x + 1]) - (a[x - 1] + 2*a[x] + a[x + 1]);
+    dx[x] = (short) gx;
+    dy[x] = (short) gy;
+    mag[x] = (short) (abs(gx) + abs(gy));
+  }
+  mag[-1] = mag[cols] = 0;
+}
+
+// non-maximum suppression of one row (magnitudes p above, m, n below) into its map row.
+// edge pixels are pushed on stack for the hysteresis
+static void suppressRow(const short* dx, const short* dy, const short* p, const short* m, const short* n,
+                        int cols, int low, int high, uchar* map, vector<uchar*>& stack)
+{
+#if defined __SSE2__
+  const __m128i vlow = _mm_set1_epi16((short) min(low, (int) SHRT_MAX));
+#endif
+  for (int x = 0; x < cols; )
+  {
+    int end = min(x + 8, cols);
+#if defined __SSE2__
+    // most pixels are below the low threshold, skip them 8 at a time
+    if (end - x == 8 && !_mm_movemask_epi8(_mm_cmpgt_epi16(_mm_loadu_si128((const __m128i*) (m + x)), vlow)))
+    {
+      x = end;
+      continue;
+    }
+#endif
+    for (; x < end; x++)
+    {
+      int v = m[x];
+      if (v <= low) continue;
+
+      int xs = dx[x], ys = dy[x];
+      int gx = abs(xs);
+      int gy = abs(ys) << CANNY_SHIFT;
+      int tg22x = gx * TG22;
+      bool is_max;
+      if (gy < tg22x) is_max = v > m[x - 1] && v >= m[x + 1]; // horizontal gradient
+      else
+      {
+        int tg67x = tg22x + (gx << (CANNY_SHIFT + 1));
+        if (gy > tg67x) is_max = v > p[x] && v >= n[x]; // vertical gradient
+        else
+        {
+          int s = (xs ^ ys) < 0 ? -1 : 1; // diagonal
+          is_max = v > p[x - s] && v > n[x + s];
+        }
+      }
+      if (!is_max) continue;
+
+      if (v > high)
+      {
+        map[x] = FusedCanny::MAP_EDGE;
+        stack.push_back(map + x);
+      }
+      else map[x] = FusedCanny::MAP_WEAK;
+    }
+  }
+}
+
+// grow the edges on the stack through weak 8-neighbours within [lo, hi) of the map.
+// promoted (if given) gets every pixel turned into an edge
+static void hysteresis(vector<uchar*>& stack, size_t mapstep, const uchar* lo, const uchar* hi,
+                       vector<uchar*>* promoted = NULL)
+{
+  const ptrdiff_t step = (ptrdiff_t) mapstep;
+  const ptrdiff_t offsets[8] = { -step - 1, -step, -step + 1, -1, 1, step - 1, step, step + 1 };
+  while (!stack.empty())
+  {
+    uchar* m = stack.back();
+    stack.pop_back();
+    for (int k = 0; k < 8; k++)
+    {
+      uchar* q = m + offsets[k];
+      if (q >= lo && q < hi && *q == FusedCanny::MAP_WEAK)
+      {
+        *q = FusedCanny::MAP_EDGE;
+        stack.push_back(q);
+        if (promoted) promoted->push_back(q);
+      }
+    }
+  }
+}
+
+// edge image from the rows of a candidate map (1 pixel border)
+static void mapToEdges(const Mat& map, Mat& edges)
+{
+  const int rows = map.rows - 2, cols = map.cols - 2;
+  edges.create(rows, cols, CV_8UC1);
+  for (int y = 0; y < rows; y++)
+  {
+    const uchar* m = map.ptr<uchar>(y + 1) + 1;
+    uchar* e = edges.ptr<uchar>(y);
+    int x = 0;
+#if defined __SSE2__
+    const __m128i edge = _mm_set1_epi8(FusedCanny::MAP_EDGE);
+    for (; x <= cols - 16; x += 16)
+      _mm_storeu_si128((__m128i*) (e + x), _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (m + x)), edge));
+#endif
+    for (; x < cols; x++) e[x] = m[x] == FusedCanny::MAP_EDGE ? 255 : 0;
+  }
+}
+
+/* ---------------------------------- bands ----------------------------------*/
+// rows [r0, r1) of a band go blur -> sobel -> suppression through 3 rolling rows each, the
+// band recomputes the 2 rows of blur and 1 of gradients it needs from its neighbours
+class EdgeBands : public ParallelLoopBody
+{
+public:
+  EdgeBands(const Mat& src, Mat& map, int low, int high, int nbands)
+    : src_(src), map_(map), low_(low), high_(high), nbands_(nbands) {}
+
+  void operator()(const Range& range) const
+  {
+    for (int i = range.start; i < range.end; i++) band(i);
+  }
+
+private:
+  void band(int i) const
+  {
+    const int rows = src_.rows, cols = src_.cols;
+    const int r0 = rows * i / nbands_, r1 = rows * (i + 1) / nbands_;
+    const int w = cols + 2; // 1 element of border on each side
+
+    // rolling rows: blurred, dx, dy, magnitude
+    vector<short> buf(12 * w);
+    vector<ushort> vsum_buf(w);
+    short *blurred[3], *dx[3], *dy[3], *mag[3];
+    for (int k = 0; k < 3; k++)
+    {
+      blurred[k] = &buf[k * w] + 1;
+      dx[k] = &buf[(3 + k) * w] + 1;
+      dy[k] = &buf[(6 + k) * w] + 1;
+      mag[k] = &buf[(9 + k) * w] + 1;
+    }
+    ushort* vsum = &vsum_buf[0] + 1;
+
+    vector<uchar*> stack;
+    int next_blur = max(r0 - 2, 0);
+    for (int y = r0 - 1; y <= r1; y++)
+    {
+      // gradients of row y, the magnitude is 0 outside the image
+      const int k = (y + 3) % 3;
+      if (y >= 0 && y < rows)
+      {
+        for (; next_blur <= min(y + 1, rows - 1); next_blur++)
+          blurRow(src_.ptr<uchar>(rowAbove(next_blur, rows)), src_.ptr<uchar>(next_blur),
+                  src_.ptr<uchar>(rowBelow(next_blur, rows)), cols, blurred[next_blur % 3], vsum);
+        sobelRow(blurred[max(y - 1, 0) % 3], blurred[y % 3], blurred[min(y + 1, rows - 1) % 3],
+                 cols, dx[k], dy[k], mag[k]);
+      }
+      else memset(mag[k] - 1, 0, w * sizeof(short));
+
+      // row y-1 has both its neighbours now
+      const int s = y - 1;
+      if (s >= r0)
+      {
+        const int ks = (s + 3) % 3;
+        uchar* m = map_.ptr<uchar>(s + 1) + 1;
+        memset(m - 1, 0, w);
+        suppressRow(dx[ks], dy[ks], mag[(s + 2) % 3], mag[ks], mag[k], cols, low_, high_, m, stack);
+      }
+    }
+
+    // hysteresis within the band, the boundaries are joined afterwards
+    hysteresis(stack, map_.step, map_.ptr<uchar>(r0 + 1), map_.ptr<uchar>(r1 + 1));
+  }
+
+  const Mat& src_;
+  Mat& map_;
+  int low_, high_, nbands_;
+};
+
+/* ---------------------------------- Fused canny ----------------------------------*/
+void FusedCanny::operator()(const Mat& src, Mat& edges, double low_thresh, double high_thresh)
+{
+  if (low_thresh > high_thresh) std::swap(low_thresh, high_thresh);
+  const int low = cvFloor(low_thresh), high = cvFloor(high_thresh);
+  const int rows = src.rows, cols = src.cols;
+
+  map_.create(rows + 2, cols + 2, CV_8UC1);
+  memset(map_.ptr<uchar>(0), 0, cols + 2);
+  memset(map_.ptr<uchar>(rows + 1), 0, cols + 2);
+
+  // a band per thread, bands shorter than 16 rows would mostly recompute their neighbours
+  const int nbands = max(1, min(getNumThreads(), rows / 16));
+  parallel_for_(Range(0, nbands), EdgeBands(src, map_, low, high, nbands));
+
+  // edges crossing a band boundary: continue from the edge pixels on both sides of it
+  vector<uchar*> stack;
+  const uchar* map_begin = map_.ptr<uchar>(0);
+  const uchar* map_end = map_.ptr<uchar>(rows + 1) + cols + 2;
+  for (int i = 1; i < nbands; i++)
+  {
+    const int r = rows * i / nbands;
+    uchar* above = map_.ptr<uchar>(r) + 1; // last row of band i-1
+    uchar* below = map_.ptr<uchar>(r + 1) + 1; // first row of band i
+    for (int x = 0; x < cols; x++)
+    {
+      for (int d = -1; d <= 1; d++)
+      {
+        if (above[x] == MAP_EDGE && below[x + d] == MAP_WEAK)
+        {
+          below[x + d] = MAP_EDGE;
+          stack.push_back(below + x + d);
+        }
+        if (below[x] == MAP_EDGE && above[x + d] == MAP_WEAK)
+        {
+          above[x + d] = MAP_EDGE;
+          stack.push_back(above + x + d);
+        }
+      }
+    }
+    hysteresis(stack, map_.step, map_begin, map_end);
+  }
+
+  mapToEdges(map_, edges);
+}
+
+double edgeMismatch(const Mat& a, const Mat& b)
+{
+  if (a.size() != b.size() || a.empty()) return 1;
+  Mat diff;
+  compare(a, b, diff, CMP_NE);
+  return countNonZero(diff) / (double) a.total();
+}
+
+/* ---------------------------------- Strip canny ----------------------------------*/
+void StripCanny::begin(const Size& size, double low_thresh, double high_thresh)
+{
+  if (low_thresh > high_thresh) std::swap(low_thresh, high_thresh);
+  low_ = cvFloor(low_thresh);
+  high_ = cvFloor(high_thresh);
+  rows_ = size.height;
+  cols_ = size.width;
+  received_ = blurred_ = sobel_ = suppressed_ = 0;
+  strip_start_ = 0;
+  strip_.release();
+
+  const int w = cols_ + 2;
+  kept_.create(2, cols_, CV_8UC1);
+  buf_.assign(13 * w, 0);
+  vsum_.resize(w);
+  map_.create(rows_ + 2, cols_ + 2, CV_8UC1);
+  memset(map_.ptr<uchar>(0), 0, w);
+  memset(map_.ptr<uchar>(rows_ + 1), 0, w);
+}
+
+const uchar* StripCanny::srcRow(int y) const
+{
+  return y >= strip_start_ ? strip_.ptr<uchar>(y - strip_start_) : kept_.ptr<uchar>(y % 2);
+}
+
+// rolling rows: 3 blurred, 3 dx, 3 dy, 3 magnitude, then a zero magnitude row for the
+// rows outside the image, all with 1 element of border
+#define STRIP_ROW(k) (&buf_[(k) * (cols_ + 2)] + 1)
+
+void StripCanny::blur(int y)
+{
+  blurRow(srcRow(rowAbove(y, rows_)), srcRow(y), srcRow(rowBelow(y, rows_)), cols_, STRIP_ROW(y % 3), &vsum_[0] + 1);
+}
+
+void StripCanny::sobel(int y)
+{
+  sobelRow(STRIP_ROW(max(y - 1, 0) % 3), STRIP_ROW(y % 3), STRIP_ROW(min(y + 1, rows_ - 1) % 3), cols_,
+           STRIP_ROW(3 + y % 3), STRIP_ROW(6 + y % 3), STRIP_ROW(9 + y % 3));
+}
+
+void StripCanny::suppress(int y)
+{
+  const short* zero = STRIP_ROW(12);
+  const short* p = y > 0 ? STRIP_ROW(9 + (y - 1) % 3) : zero;
+  const short* n = y < rows_ - 1 ? STRIP_ROW(9 + (y + 1) % 3) : zero;
+  uchar* m = map_.ptr<uchar>(y + 1) + 1;
+  memset(m - 1, 0, cols_ + 2);
+  suppressRow(STRIP_ROW(3 + y % 3), STRIP_ROW(6 + y % 3), p, STRIP_ROW(9 + y % 3), n, cols_, low_, high_, m, stack_);
+
+  // weak pixels touching an edge of the row above. the rows below are not there yet, they
+  // check this row when they come in
+  const uchar* above = m - map_.step;
+  for (int x = 0; x < cols_; x++)
+  {
+    if (m[x] == FusedCanny::MAP_WEAK && (above[x - 1] == FusedCanny::MAP_EDGE || above[x] == FusedCanny::MAP_EDGE
+                                         || above[x + 1] == FusedCanny::MAP_EDGE))
+    {
+      m[x] = FusedCanny::MAP_EDGE;
+      stack_.push_back(m + x);
+    }
+  }
+  promoted_.insert(promoted_.end(), stack_.begin(), stack_.end());
+  hysteresis(stack_, map_.step, map_.ptr<uchar>(0), m + cols_ + 1, &promoted_);
+}
+
+void StripCanny::push(const Mat& strip, vector<Point>& edge_pts)
+{
+  strip_ = strip;
+  strip_start_ = received_;
+  received_ += strip.rows;
+
+  // run every stage as far as the rows allow, suppression first so the rolling rows it
+  // still needs are not overwritten
+  while (true)
+  {
+    if (suppressed_ < rows_ && (sobel_ > suppressed_ + 1 || sobel_ == rows_))
+      suppress(suppressed_++);
+    else if (sobel_ < rows_ && sobel_ <= suppressed_ + 1 && (blurred_ > sobel_ + 1 || blurred_ == rows_))
+      sobel(sobel_++);
+    else if (blurred_ < rows_ && blurred_ <= sobel_ + 1 && (received_ > blurred_ + 1 || received_ == rows_))
+      blur(blurred_++);
+    else break;
+  }
+
+  // keep the rows the next strip's blur reaches back to
+  for (int y = max(strip_start_, received_ - 2); y < received_; y++)
+    memcpy(kept_.ptr<uchar>(y % 2), strip_.ptr<uchar>(y - strip_start_), cols_);
+  strip_.release();
+
+  const uchar* origin = map_.ptr<uchar>(1) + 1;
+  const size_t step = map_.step;
+  for (size_t i = 0; i < promoted_.size(); i++)
+  {
+    size_t offset = promoted_[i] - origin;
+    edge_pts.push_back(Point((int) (offset % step), (int) (offset / step)));
+  }
+  promoted_.clear();
+}
+
+void StripCanny::edges(Mat& edges) const
+{
+  mapToEdges(map_, edges);
+}
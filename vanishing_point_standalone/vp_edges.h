@@ -0,0 +1,71 @@
+/**
+ * @file vp_edges.h
+ * @brief Fused edge kernel: 3x3 box blur + sobel + canny in one pass over row bands
+ */
+
+#ifndef VP_EDGES_H
+#define VP_EDGES_H
+
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+/* ---------------------------------- Fused canny ----------------------------------*/
+// same edges as
+//   blur(src, tmp, Size(3,3)); Canny(tmp, edges, low, high, 3);
+// without the full frame blurred and gradient images in between: each row band streams
+// blur -> sobel -> non-maximum suppression through a few rolling rows and the bands run
+// in parallel. hysteresis runs per band, then across the band boundaries.
+class FusedCanny
+{
+public:
+  // src: CV_8UC1. edges: CV_8UC1, 255 on edges
+  void operator()(const cv::Mat& src, cv::Mat& edges, double low, double high);
+
+  // candidate map, 1 pixel border: 0 = no edge, 1 = weak (above low), 2 = edge
+  enum { MAP_NONE = 0, MAP_WEAK = 1, MAP_EDGE = 2 };
+
+private:
+  cv::Mat map_;
+};
+
+/* ---------------------------------- Strip canny ----------------------------------*/
+// the same edges, computed while the frame arrives as horizontal strips (top to bottom).
+// every stage runs as soon as the rows it needs are in, so after the last strip only its
+// own few rows are left. only the 2 last rows of a strip are kept for the next one.
+// pixels are reported once, when they become edges, since hysteresis can still turn a
+// weak pixel of an earlier strip into an edge.
+class StripCanny
+{
+public:
+  StripCanny() : rows_(0), cols_(0) {}
+
+  // start a frame of size (CV_8UC1)
+  void begin(const cv::Size& size, double low, double high);
+  // next strip, strip.cols == size.width. pixels that became edges are appended to edge_pts
+  void push(const cv::Mat& strip, std::vector<cv::Point>& edge_pts);
+  // every row was pushed and processed
+  bool done() const { return rows_ > 0 && suppressed_ == rows_; }
+  // edge image of the frame so far (255 on edges)
+  void edges(cv::Mat& edges) const;
+
+private:
+  const unsigned char* srcRow(int y) const;
+  void blur(int y);
+  void sobel(int y);
+  void suppress(int y);
+
+  int rows_, cols_, low_, high_;
+  int received_, blurred_, sobel_, suppressed_; // next row for each stage
+  cv::Mat strip_; // current strip, rows [strip_start_, received_)
+  int strip_start_;
+  cv::Mat kept_; // the 2 last rows of the previous strips, by row % 2
+  std::vector<short> buf_; // rolling rows: blurred, dx, dy, magnitude x 3, zero row
+  std::vector<unsigned short> vsum_;
+  cv::Mat map_; // candidate map, see FusedCanny
+  std::vector<unsigned char*> stack_, promoted_;
+};
+
+// fraction of pixels where a and b disagree
+double edgeMismatch(const cv::Mat& a, const cv::Mat& b);
+
+#endif // VP_EDGES_H
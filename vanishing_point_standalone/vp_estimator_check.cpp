@@ -0,0 +1,114 @@
+/**
+ * @file vp_estimator_check.cpp
+ * @brief Check the voting estimator against ransac on synthetic scenes, vp inside and outside the image
+ *
+ * usage: ./vp_estimator_check [--tolerance PX]
+ *
+ * every scene is a frame of lines converging at a known vp, with a crossing line whose
+ * intersections land inside the image. both estimators run on the same frame (ransac with
+ * vote_max_lines = 0). exits with 1 if either misses the vp or they are further apart than
+ * the tolerance (default threshold_ransac) after clamping to the image.
+ */
+
+#include "opencv2/core/core.hpp"
+#include "vp_detector.h"
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+using namespace cv;
+using namespace std;
+
+struct Scene
+{
+  const char* name;
+  Point vp; // where the lines meet, may be outside the image
+  double spread; // degrees between the outermost lines
+};
+
+// an off-image vp needs lines on both sides of it (road edges below, wall or tree
+// tops above) for the theta buckets to pair them
+static const Scene scenes[] = {
+  { "straight", Point(320, 180), 100 },
+  { "left turn", Point(-250, 160), 50 },
+  { "right turn", Point(950, 200), 40 },
+  { "crest", Point(320, -200), 60 },
+};
+
+// a fan of lines through the vp towards the image centre, and one crossing line
+static void drawScene(const Scene& s, Mat& frame)
+{
+  frame.create(480, 640, CV_8UC1);
+  frame.setTo(Scalar(60));
+  const int n = 7;
+  double centre = atan2(frame.rows/2 - s.vp.y, frame.cols/2 - s.vp.x);
+  for (int i = 0; i < n; i++)
+  {
+    double a = centre + (i - (n - 1)/2.0) / (n - 1) * s.spread * CV_PI/180;
+    // far enough to cross the whole image, line() clips
+    Point end(cvRound(s.vp.x + 4000*cos(a)), cvRound(s.vp.y + 4000*sin(a)));
+    line(frame, s.vp, end, Scalar(220), 2);
+  }
+  // a shadow across the road
+  line(frame, Point(0, 400), Point(frame.cols - 1, 330), Scalar(200), 2);
+}
+
+static Point clampToImage(Point p, const VPParams& params)
+{
+  p.x = min(max(p.x, 0), params.width);
+  p.y = min(max(p.y, 0), params.height);
+  return p;
+}
+
+int main(int argc, char** argv)
+{
+  int tolerance = VPParams().threshold_ransac;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) tolerance = atoi(argv[++i]);
+    else
+    {
+      cerr << "usage: " << argv[0] << " [--tolerance PX]" << endl;
+      return 1;
+    }
+  }
+
+  int failed = 0;
+  const int n_scenes = sizeof(scenes)/sizeof(scenes[0]);
+  for (int k = 0; k < n_scenes; k++)
+  {
+    const Scene& s = scenes[k];
+    Mat frame;
+    drawScene(s, frame);
+
+    // every frame is measured, none is reused as static
+    VPParams vote_params;
+    vote_params.static_threshold = 0;
+    VPParams ransac_params = vote_params;
+    ransac_params.vote_max_lines = 0;
+    VanishingPointDetector vote(vote_params), ransac(ransac_params);
+    VPResult v, r;
+    vote.detect(frame, v);
+    ransac.detect(frame, r);
+
+    Point expected = clampToImage(s.vp, vote_params);
+    bool voted = v.n_lines < vote_params.vote_max_lines;
+    bool ok = voted && v.found && r.found
+              && abs(v.vp.x - r.vp.x) <= tolerance && abs(v.vp.y - r.vp.y) <= tolerance
+              && abs(v.vp.x - expected.x) <= tolerance && abs(v.vp.y - expected.y) <= tolerance;
+    cout << s.name << ": vp " << s.vp.x << "," << s.vp.y << " (" << expected.x << "," << expected.y << " clamped), "
+         << v.n_lines << " lines | vote " << v.vp.x << "," << v.vp.y << (v.found ? "" : " not found")
+         << " | ransac " << r.vp.x << "," << r.vp.y << (r.found ? "" : " not found")
+         << (voted ? "" : " | too many lines to vote") << (ok ? "" : " | FAILED") << endl;
+    if (!ok) failed++;
+  }
+
+  if (failed)
+  {
+    cout << "FAILED: " << failed << "/" << n_scenes << " scenes" << endl;
+    return 1;
+  }
+  cout << "OK" << endl;
+  return 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file vp_hough.cpp
+ * @brief Standard hough accumulator that takes its votes one edge pixel at a time
+ */
+
+#include "vp_hough.h"
+#include <algorithm>
+#include <math.h>
+
+using namespace cv;
+using namespace std;
+
+// rho = 1 px, theta = 1 degree
+static const double HOUGH_THETA = CV_PI/180;
+
+void HoughAccumulator::reset(int width, int height)
+{
+  if (width != width_ || height != height_)
+  {
+    width_ = width;
+    height_ = height;
+    numangle_ = cvRound(CV_PI / HOUGH_THETA);
+    numrho_ = cvRound(((width + height) * 2 + 1) / 1.0);
+    tabSin_.resize(numangle_);
+    tabCos_.resize(numangle_);
+    float ang = 0;
+    for (int n = 0; n < numangle_; ang += (float) HOUGH_THETA, n++)
+    {
+      tabSin_[n] = (float) sin((double) ang);
+      tabCos_[n] = (float) cos((double) ang);
+    }
+  }
+  accum_.assign((numangle_ + 2) * (numrho_ + 2), 0);
+}
+
+// strongest first, lower index first on ties
+struct VotesGreater
+{
+  const int* accum;
+  VotesGreater(const int* a) : accum(a) {}
+  bool operator()(int a, int b) const { return accum[a] > accum[b] || (accum[a] == accum[b] && a < b); }
+};
+
+void HoughAccumulator::lines(int threshold, vector<Vec2f>& lines) const
+{
+  const int* accum = &accum_[0];
+  const int step = numrho_ + 2;
+  vector<int> peaks;
+  for (int r = 0; r < numrho_; r++)
+    for (int n = 0; n < numangle_; n++)
+    {
+      int base = (n + 1) * step + r + 1;
+      if (accum[base] > threshold &&
+          accum[base] > accum[base - 1] && accum[base] >= accum[base + 1] &&
+          accum[base] > accum[base - step] && accum[base] >= accum[base + step])
+        peaks.push_back(base);
+    }
+
+  sort(peaks.begin(), peaks.end(), VotesGreater(accum));
+
+  lines.resize(peaks.size());
+  const double scale = 1./step;
+  for (size_t i = 0; i < peaks.size(); i++)
+  {
+    int idx = peaks[i];
+    int n = cvFloor(idx*scale) - 1;
+    int r = idx - (n + 1) * step - 1;
+    lines[i] = Vec2f((r - (numrho_ - 1)*0.5f), (float) (n * HOUGH_THETA));
+  }
+}
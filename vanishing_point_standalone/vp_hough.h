@@ -0,0 +1,39 @@
+/**
+ * @file vp_hough.h
+ * @brief Standard hough accumulator that takes its votes one edge pixel at a time
+ */
+
+#ifndef VP_HOUGH_H
+#define VP_HOUGH_H
+
+#include "opencv2/core/core.hpp"
+#include <vector>
+
+/* ---------------------------------- Accumulator ----------------------------------*/
+// HoughLines(edges, lines, 1, CV_PI/180, threshold) split in two: vote() for every edge
+// pixel as it is found, lines() for the peaks once the frame is complete. same tables,
+// rounding and peak ordering, so the lines are the same
+class HoughAccumulator
+{
+public:
+  HoughAccumulator() : width_(0), height_(0), numangle_(0), numrho_(0) {}
+
+  // clear the votes for a width x height frame
+  void reset(int width, int height);
+  void vote(int x, int y)
+  {
+    int* row = &accum_[numrho_ + 2] + 1 + (numrho_ - 1) / 2;
+    for (int n = 0; n < numangle_; n++, row += numrho_ + 2)
+      row[cvRound(x * tabCos_[n] + y * tabSin_[n])]++;
+  }
+  // local maxima with more than threshold votes, strongest first
+  void lines(int threshold, std::vector<cv::Vec2f>& lines) const;
+
+private:
+  int width_, height_;
+  int numangle_, numrho_;
+  std::vector<int> accum_; // (numangle + 2) x (numrho + 2), 1 cell of border
+  std::vector<float> tabSin_, tabCos_;
+};
+
+#endif // VP_HOUGH_H
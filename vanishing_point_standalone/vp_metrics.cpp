@@ -0,0 +1,208 @@
+/**
+ * @file vp_metrics.cpp
+ * @brief Detector health metrics served in prometheus text format on a unix socket
+ */
+
+#include "vp_metrics.h"
+#include "vp_time.h"
+#include <poll.h>
+#include <sstream>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const char* stage_name[] = { "edges", "hough", "ransac", "total" };
+
+// stage latency buckets: 50us .. 100ms
+static const uint64_t latency_bounds[] = { 50000, 100000, 250000, 500000, 1000000, 2500000,
+                                           5000000, 10000000, 25000000, 50000000, 100000000 };
+static const uint64_t lines_bounds[] = { 1, 2, 5, 10, 20, 50, 100, 200 };
+// inlier ratio in per mille
+static const uint64_t ratio_bounds[] = { 100, 200, 300, 400, 500, 600, 700, 800, 900, 1000 };
+
+#define N_BOUNDS(a) (sizeof(a)/sizeof(a[0]))
+
+/* ---------------------------------- Histogram ----------------------------------*/
+Histogram::Histogram(const uint64_t* bounds, int n, double scale)
+  : n_(n < MAX_BUCKETS ? n : MAX_BUCKETS), scale_(scale), sum_(0)
+{
+  for (int i = 0; i < n_; i++) bounds_[i] = bounds[i];
+  for (int i = 0; i <= MAX_BUCKETS; i++) counts_[i].store(0);
+}
+
+void Histogram::write(ostream& os, const char* name, const string& label) const
+{
+  string sep = label.empty() ? "" : ",";
+  uint64_t cumulative = 0;
+  for (int i = 0; i <= n_; i++)
+  {
+    cumulative += counts_[i].load(memory_order_relaxed);
+    os << name << "_bucket{" << label << sep << "le=\"";
+    if (i < n_) os << bounds_[i] / scale_;
+    else os << "+Inf";
+    os << "\"} " << cumulative << "\n";
+  }
+  string braces = label.empty() ? "" : "{" + label + "}";
+  os << name << "_sum" << braces << " " << sum_.load(memory_order_relaxed) / scale_ << "\n";
+  os << name << "_count" << braces << " " << cumulative << "\n";
+}
+
+/* ---------------------------------- Metrics ----------------------------------*/
+VPMetrics::VPMetrics()
+  : frames_total_(0), frames_dropped_(0), frames_reused_(0), hough_threshold_(0), canny_threshold_(0),
+    lines_(lines_bounds, N_BOUNDS(lines_bounds), 1), inlier_ratio_(ratio_bounds, N_BOUNDS(ratio_bounds), 1000),
+    last_scrape_ns_(now_ns()), last_scrape_frames_(0), listen_fd_(-1), stop_(false)
+{
+  for (int i = 0; i < 3; i++) frames_quality_[i].store(0);
+  for (int i = 0; i < N_STAGES; i++) latency_[i] = new Histogram(latency_bounds, N_BOUNDS(latency_bounds), 1e9);
+}
+
+VPMetrics::~VPMetrics()
+{
+  stop_ = true;
+  if (server_.joinable()) server_.join();
+  if (listen_fd_ >= 0)
+  {
+    close(listen_fd_);
+    unlink(socket_path_.c_str());
+  }
+  for (int i = 0; i < N_STAGES; i++) delete latency_[i];
+}
+
+void VPMetrics::observe(const VPResult& result, const VanishingPointDetector& detector)
+{
+  frames_total_.fetch_add(1, memory_order_relaxed);
+  frames_quality_[result.quality].fetch_add(1, memory_order_relaxed);
+  latency_[STAGE_TOTAL]->observe(result.total_ns);
+
+  // a reused result did not run the pipeline, its stages would only skew the histograms
+  if (result.age > 0)
+  {
+    frames_reused_.fetch_add(1, memory_order_relaxed);
+    return;
+  }
+  latency_[STAGE_EDGES]->observe(result.edge_ns);
+  latency_[STAGE_HOUGH]->observe(result.hough_ns);
+  latency_[STAGE_RANSAC]->observe(result.ransac_ns);
+  lines_.observe(result.n_lines);
+  if (result.found && result.n_lines > 0)
+    inlier_ratio_.observe(1000 * result.inliers / result.n_lines);
+
+  const HoughControllerState& ctrl = detector.houghController();
+  bool controlled = detector.params().line_band_max > 0;
+  hough_threshold_.store(controlled ? ctrl.threshold : detector.params().min_threshold + detector.params().s_trackbar,
+                         memory_order_relaxed);
+  canny_threshold_.store(controlled ? ctrl.lowThreshold : detector.params().lowThreshold, memory_order_relaxed);
+}
+
+/* ---------------------------------- exposition ----------------------------------*/
+void VPMetrics::write(ostream& os)
+{
+  uint64_t frames = frames_total_.load(memory_order_relaxed);
+  uint64_t now = now_ns();
+  double fps = now > last_scrape_ns_ ? (double) (frames - last_scrape_frames_) * BILLION / (now - last_scrape_ns_) : 0;
+  last_scrape_ns_ = now;
+  last_scrape_frames_ = frames;
+
+  os << "# HELP vp_frames_total Frames processed by the detector.\n"
+     << "# TYPE vp_frames_total counter\n"
+     << "vp_frames_total " << frames << "\n"
+     << "# HELP vp_frames_dropped_total Frames that never reached the detector.\n"
+     << "# TYPE vp_frames_dropped_total counter\n"
+     << "vp_frames_dropped_total " << frames_dropped_.load(memory_order_relaxed) << "\n"
+     << "# HELP vp_frames_quality_total Frames by result quality (predicted = no detection).\n"
+     << "# TYPE vp_frames_quality_total counter\n";
+  const char* quality[] = { "full", "degraded", "predicted" };
+  for (int i = 0; i < 3; i++)
+    os << "vp_frames_quality_total{quality=\"" << quality[i] << "\"} " << frames_quality_[i].load(memory_order_relaxed) << "\n";
+  os << "# HELP vp_frames_reused_total Static frames that reused the previous result.\n"
+     << "# TYPE vp_frames_reused_total counter\n"
+     << "vp_frames_reused_total " << frames_reused_.load(memory_order_relaxed) << "\n"
+     << "# HELP vp_fps Frames per second since the previous scrape.\n"
+     << "# TYPE vp_fps gauge\n"
+     << "vp_fps " << fps << "\n"
+     << "# HELP vp_hough_threshold Hough vote threshold in use.\n"
+     << "# TYPE vp_hough_threshold gauge\n"
+     << "vp_hough_threshold " << hough_threshold_.load(memory_order_relaxed) << "\n"
+     << "# HELP vp_canny_threshold Canny low threshold in use.\n"
+     << "# TYPE vp_canny_threshold gauge\n"
+     << "vp_canny_threshold " << canny_threshold_.load(memory_order_relaxed) << "\n";
+
+  os << "# HELP vp_stage_latency_seconds Time spent per frame in each detector stage.\n"
+     << "# TYPE vp_stage_latency_seconds histogram\n";
+  for (int i = 0; i < N_STAGES; i++)
+    latency_[i]->write(os, "vp_stage_latency_seconds", string("stage=\"") + stage_name[i] + "\"");
+  os << "# HELP vp_lines Lines handed to the estimator per frame.\n"
+     << "# TYPE vp_lines histogram\n";
+  lines_.write(os, "vp_lines", "");
+  os << "# HELP vp_inlier_ratio Inliers of the best model over lines, per detected frame.\n"
+     << "# TYPE vp_inlier_ratio histogram\n";
+  inlier_ratio_.write(os, "vp_inlier_ratio", "");
+}
+
+/* ---------------------------------- server ----------------------------------*/
+bool VPMetrics::serve(const string& socket_path)
+{
+  struct sockaddr_un addr;
+  if (socket_path.size() >= sizeof(addr.sun_path)) return false;
+
+  listen_fd_ = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd_ < 0) { perror("vp_metrics: socket"); return false; }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, socket_path.c_str(), sizeof(addr.sun_path) - 1);
+  unlink(socket_path.c_str()); // left over from a previous run
+  if (bind(listen_fd_, (struct sockaddr*) &addr, sizeof(addr)) < 0 || listen(listen_fd_, 4) < 0)
+  {
+    perror("vp_metrics: bind");
+    close(listen_fd_);
+    listen_fd_ = -1;
+    return false;
+  }
+
+  socket_path_ = socket_path;
+  server_ = thread(&VPMetrics::run, this);
+  return true;
+}
+
+void VPMetrics::run()
+{
+  struct pollfd pfd;
+  pfd.fd = listen_fd_;
+  pfd.events = POLLIN;
+  while (!stop_)
+  {
+    // wake up regularly to notice stop_
+    if (poll(&pfd, 1, 200) <= 0) continue;
+    int fd = accept(listen_fd_, NULL, NULL);
+    if (fd < 0) continue;
+
+    // the request itself does not matter, every path returns the metrics
+    char request[1024];
+    struct pollfd cfd;
+    cfd.fd = fd;
+    cfd.events = POLLIN;
+    if (poll(&cfd, 1, 100) > 0 && recv(fd, request, sizeof(request), 0) < 0) { close(fd); continue; }
+
+    ostringstream body;
+    write(body);
+    string b = body.str();
+    ostringstream response;
+    response << "HTTP/1.0 200 OK\r\n"
+             << "Content-Type: text/plain; version=0.0.4\r\n"
+             << "Content-Length: " << b.size() << "\r\n\r\n" << b;
+    string r = response.str();
+    for (size_t sent = 0; sent < r.size(); )
+    {
+      ssize_t n = send(fd, r.data() + sent, r.size() - sent, MSG_NOSIGNAL);
+      if (n <= 0) break;
+      sent += n;
+    }
+    close(fd);
+  }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file vp_metrics.h
+ * @brief Detector health metrics served in prometheus text format on a unix socket.
+ *
+ * The frame path only does relaxed atomic increments; formatting happens on the server
+ * thread when a scrape comes in:
+ *   curl --unix-socket /tmp/vp_metrics.sock http://localhost/metrics
+ */
+
+#ifndef VP_METRICS_H
+#define VP_METRICS_H
+
+#include "vp_detector.h"
+#include <atomic>
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+/* ---------------------------------- Histogram ----------------------------------*/
+// fixed buckets, values are recorded as integers (ns, lines, per mille) and divided by
+// scale for the exposition
+class Histogram
+{
+public:
+  enum { MAX_BUCKETS = 16 };
+
+  // bounds: upper bucket bounds in recorded units, ascending, +Inf is implicit
+  Histogram(const uint64_t* bounds, int n, double scale);
+
+  void observe(uint64_t v)
+  {
+    int i = 0;
+    while (i < n_ && v > bounds_[i]) i++;
+    counts_[i].fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(v, std::memory_order_relaxed);
+  }
+
+  // label: extra label pair like stage="edges", may be empty
+  void write(std::ostream& os, const char* name, const std::string& label) const;
+
+private:
+  uint64_t bounds_[MAX_BUCKETS];
+  int n_;
+  double scale_;
+  std::atomic<uint64_t> counts_[MAX_BUCKETS + 1];
+  std::atomic<uint64_t> sum_;
+};
+
+/* ---------------------------------- Metrics ----------------------------------*/
+class VPMetrics
+{
+public:
+  VPMetrics();
+  ~VPMetrics(); // stops the server
+
+  // frame path: record one detector result (and the detector's controller state)
+  void observe(const VPResult& result, const VanishingPointDetector& detector);
+  // frame path: frames that never reached the detector (camera sequence gaps, ...)
+  void dropFrames(uint64_t n) { frames_dropped_.fetch_add(n, std::memory_order_relaxed); }
+
+  // serve the metrics on a unix domain socket (plain http, any request path). false on failure
+  bool serve(const std::string& socket_path);
+  // prometheus text exposition of the current values
+  void write(std::ostream& os);
+
+private:
+  void run();
+
+  enum { STAGE_EDGES, STAGE_HOUGH, STAGE_RANSAC, STAGE_TOTAL, N_STAGES };
+
+  std::atomic<uint64_t> frames_total_, frames_dropped_;
+  std::atomic<uint64_t> frames_quality_[3]; // by VPQuality
+  std::atomic<uint64_t> frames_reused_;
+  std::atomic<int64_t> hough_threshold_, canny_threshold_;
+  Histogram* latency_[N_STAGES];
+  Histogram lines_, inlier_ratio_;
+
+  // fps over the interval between two scrapes (server thread only)
+  uint64_t last_scrape_ns_, last_scrape_frames_;
+
+  int listen_fd_;
+  std::string socket_path_;
+  std::atomic<bool> stop_;
+  std::thread server_;
+};
+
+#endif // VP_METRICS_H
@@ -0,0 +1,57 @@
+/**
+ * @file vp_overlay.cpp
+ * @brief Debug overlay of a detection: edges, hough lines, best pair, vp, crosshair
+ */
+
+#include "vp_overlay.h"
+#include "opencv2/imgproc/imgproc.hpp"
+#include <math.h>
+
+using namespace cv;
+using namespace std;
+
+/* -------------------------------------- draw line --------------------------------------------*/
+void drawLine(Mat& img, const Vec2f& l, const Scalar& color, int thickness)
+{
+  float r = l[0], t = l[1];
+  double cos_t = cos(t), sin_t = sin(t);
+  double x0 = r*cos_t, y0 = r*sin_t;
+  double alpha = 1000;
+
+  Point pt1( cvRound(x0 + alpha*(-sin_t)), cvRound(y0 + alpha*cos_t) );
+  Point pt2( cvRound(x0 - alpha*(-sin_t)), cvRound(y0 - alpha*cos_t) );
+  line( img, pt1, pt2, color, thickness, CV_AA);
+}
+
+/* -------------------------------------- overlay --------------------------------------------*/
+void drawOverlay(Mat& out, const Mat& edges, const vector<Vec2f>& lines, const VPResult& result)
+{
+  const int width = edges.cols;
+  const int height = edges.rows;
+
+  cvtColor( edges, out, CV_GRAY2BGR );
+
+  for( size_t i = 0; i < lines.size(); i++ )
+    drawLine(out, lines[i], Scalar(255,0,0), 1);
+
+  if (result.found)
+  {
+    // best pair of lines
+    if (result.a_best >= 0 && result.b_best >= 0 &&
+        result.a_best < (int) lines.size() && result.b_best < (int) lines.size())
+    {
+      drawLine(out, lines[result.a_best], Scalar(0,0,255), 1);
+      drawLine(out, lines[result.b_best], Scalar(0,0,255), 1);
+    }
+    circle(out, result.vp, 3,  Scalar(0,255,0), 2, 8, 0 );
+    circle(out, result.mid, 3,  Scalar(0,0,255), 2, 8, 0 );
+  }
+
+  // draw cross hair
+  Point pt1_v( cvRound(width/2.0), 0);
+  Point pt2_v( cvRound(width/2.0), height);
+  line( out, pt1_v, pt2_v, Scalar(0,255,255), 1, CV_AA);
+  Point pt1_h( 0, cvRound(height/2.0));
+  Point pt2_h( width, cvRound(height/2.0));
+  line( out, pt1_h, pt2_h, Scalar(0,255,255), 1, CV_AA);
+}
@@ -0,0 +1,20 @@
+/**
+ * @file vp_overlay.h
+ * @brief Debug overlay of a detection: edges, hough lines, best pair, vp, crosshair
+ */
+
+#ifndef VP_OVERLAY_H
+#define VP_OVERLAY_H
+
+#include "opencv2/core/core.hpp"
+#include "vp_detector.h"
+#include <vector>
+
+// draw a line given in (rho, theta) form across the whole image
+void drawLine(cv::Mat& img, const cv::Vec2f& l, const cv::Scalar& color, int thickness);
+
+// render the overlay of one result into out (bgr, size of edges). lines are the lines the
+// result was estimated from (a_best/b_best index into them)
+void drawOverlay(cv::Mat& out, const cv::Mat& edges, const std::vector<cv::Vec2f>& lines, const VPResult& result);
+
+#endif // VP_OVERLAY_H
@@ -0,0 +1,157 @@
+/**
+ * @file vp_raw.cpp
+ * @brief Raw Y8 frame recordings: writer, and a zero-copy memory mapped frame source
+ */
+
+#include "vp_raw.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace cv;
+using namespace std;
+
+bool isRawRecording(const string& path)
+{
+  return path.size() > 3 && path.compare(path.size() - 3, 3, ".y8") == 0;
+}
+
+/* ---------------------------------- Writer ----------------------------------*/
+RawRecordingWriter::RawRecordingWriter() : f_(NULL) {}
+
+RawRecordingWriter::~RawRecordingWriter() { close(); }
+
+bool RawRecordingWriter::open(const string& path, int width, int height)
+{
+  f_ = fopen(path.c_str(), "wb");
+  if (!f_) { perror("vp_raw: fopen"); return false; }
+
+  memset(&header_, 0, sizeof(header_));
+  header_.magic = RawHeader::MAGIC;
+  header_.version = RawHeader::VERSION;
+  header_.width = width;
+  header_.height = height;
+  stamps_.clear();
+
+  // placeholder header, rewritten by close()
+  vector<char> pad(RawHeader::SIZE, 0);
+  return fwrite(&pad[0], 1, pad.size(), f_) == pad.size();
+}
+
+bool RawRecordingWriter::write(const Mat& gray, uint64_t stamp_ns)
+{
+  if (!f_ || gray.type() != CV_8UC1 || gray.cols != (int) header_.width || gray.rows != (int) header_.height)
+    return false;
+
+  for (int i = 0; i < gray.rows; i++)
+    if (fwrite(gray.ptr(i), 1, gray.cols, f_) != (size_t) gray.cols) return false;
+  stamps_.push_back(stamp_ns);
+  return true;
+}
+
+bool RawRecordingWriter::close()
+{
+  if (!f_) return false;
+  header_.n_frames = stamps_.size();
+  header_.index_offset = RawHeader::SIZE + header_.n_frames * header_.width * header_.height;
+
+  bool ok = stamps_.empty() || fwrite(&stamps_[0], sizeof(uint64_t), stamps_.size(), f_) == stamps_.size();
+  ok = ok && fseek(f_, 0, SEEK_SET) == 0 && fwrite(&header_, sizeof(header_), 1, f_) == 1;
+  ok = (fclose(f_) == 0) && ok;
+  f_ = NULL;
+  return ok;
+}
+
+/* ---------------------------------- Source ----------------------------------*/
+RawFrameSource::RawFrameSource()
+  : map_(NULL), map_size_(0), header_(NULL), frames_(NULL), stamps_(NULL), next_(0) {}
+
+RawFrameSource::~RawFrameSource() { close(); }
+
+bool RawFrameSource::open(const string& path)
+{
+  close();
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) { perror("vp_raw: open"); return false; }
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < RawHeader::SIZE) { ::close(fd); return false; }
+
+  void* p = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) { perror("vp_raw: mmap"); return false; }
+  // replays read front to back: let the kernel read ahead
+  madvise(p, st.st_size, MADV_SEQUENTIAL);
+
+  const RawHeader* h = static_cast<const RawHeader*>(p);
+  uint64_t frame_size = (uint64_t) h->width * h->height;
+  if (h->magic != RawHeader::MAGIC || h->version != RawHeader::VERSION
+      || h->index_offset != RawHeader::SIZE + h->n_frames * frame_size
+      || (uint64_t) st.st_size < h->index_offset + h->n_frames * sizeof(uint64_t))
+  {
+    fprintf(stderr, "vp_raw: %s is not a complete raw recording\n", path.c_str());
+    munmap(p, st.st_size);
+    return false;
+  }
+
+  map_ = p;
+  map_size_ = st.st_size;
+  header_ = h;
+  frames_ = static_cast<const uint8_t*>(p) + RawHeader::SIZE;
+  stamps_ = reinterpret_cast<const uint64_t*>(static_cast<const uint8_t*>(p) + h->index_offset);
+  next_ = 0;
+  return true;
+}
+
+void RawFrameSource::close()
+{
+  if (map_) munmap(map_, map_size_);
+  map_ = NULL;
+  map_size_ = 0;
+  header_ = NULL;
+}
+
+Mat RawFrameSource::frame(size_t i) const
+{
+  // header only, the data stays in the mapping
+  uint8_t* data = const_cast<uint8_t*>(frames_ + i * header_->width * header_->height);
+  return Mat(header_->height, header_->width, CV_8UC1, data);
+}
+
+bool RawFrameSource::read(Mat& frame, uint64_t& stamp_ns)
+{
+  if (next_ >= size()) return false;
+  frame = this->frame(next_);
+  stamp_ns = stamps_[next_];
+  next_++;
+  return true;
+}
+
+/* ---------------------------------- Strip source ----------------------------------*/
+bool RawStripSource::open(const string& path, int strip_rows)
+{
+  strip_rows_ = max(1, strip_rows);
+  frame_ = 0;
+  row_ = 0;
+  return source_.open(path);
+}
+
+bool RawStripSource::read(Mat& strip, int& row, uint64_t& stamp_ns)
+{
+  if (frame_ >= source_.size()) return false;
+  const int rows = source_.height();
+  const int end = min(row_ + strip_rows_, rows);
+  strip = source_.frame(frame_).rowRange(row_, end);
+  row = row_;
+  stamp_ns = source_.stamp(frame_);
+
+  row_ = end;
+  if (row_ == rows)
+  {
+    row_ = 0;
+    frame_++;
+  }
+  return true;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file vp_raw.h
+ * @brief Raw Y8 frame recordings: writer, and a zero-copy memory mapped frame source.
+ *
+ * File layout (little endian):
+ *   header, padded to 4096 bytes so every frame starts page aligned
+ *   n_frames frames of width*height bytes (8-bit gray, row major, no padding)
+ *   index: n_frames uint64 capture stamps in ns
+ */
+
+#ifndef VP_RAW_H
+#define VP_RAW_H
+
+#include "opencv2/core/core.hpp"
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/* ---------------------------------- Format ----------------------------------*/
+struct RawHeader
+{
+  enum { MAGIC = 0x38595056, VERSION = 1, SIZE = 4096 }; // "VPY8"
+
+  uint32_t magic;
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint64_t n_frames;
+  uint64_t index_offset; // byte offset of the stamp index
+};
+
+/* ---------------------------------- Writer ----------------------------------*/
+class RawRecordingWriter
+{
+public:
+  RawRecordingWriter();
+  ~RawRecordingWriter(); // close()s
+
+  bool open(const std::string& path, int width, int height);
+  // append an 8-bit single channel frame of the recording size
+  bool write(const cv::Mat& gray, uint64_t stamp_ns);
+  // write the index and the final header
+  bool close();
+
+private:
+  FILE* f_;
+  RawHeader header_;
+  std::vector<uint64_t> stamps_;
+};
+
+/* ---------------------------------- Source ----------------------------------*/
+// frames are cv::Mat headers pointing into the read-only mapping: no decode, no copy.
+// they stay valid as long as the source is open and must not be written to
+class RawFrameSource
+{
+public:
+  RawFrameSource();
+  ~RawFrameSource();
+
+  bool open(const std::string& path);
+  void close();
+
+  size_t size() const { return header_ ? header_->n_frames : 0; }
+  int width() const { return header_ ? header_->width : 0; }
+  int height() const { return header_ ? header_->height : 0; }
+
+  // random access
+  cv::Mat frame(size_t i) const;
+  uint64_t stamp(size_t i) const { return stamps_[i]; }
+  // sequential access, like VideoCapture::read. false at the end of the recording
+  bool read(cv::Mat& frame, uint64_t& stamp_ns);
+
+private:
+  void* map_;
+  size_t map_size_;
+  const RawHeader* header_;
+  const uint8_t* frames_;
+  const uint64_t* stamps_;
+  size_t next_;
+};
+
+// replays a recording as horizontal strips of strip_rows rows, top to bottom, the way a
+// rolling shutter camera hands a frame out. strips point into the mapping like frames
+class RawStripSource
+{
+public:
+  RawStripSource() : strip_rows_(0), frame_(0), row_(0) {}
+
+  bool open(const std::string& path, int strip_rows);
+  const RawFrameSource& frames() const { return source_; }
+
+  // next strip, row is its first row (0 starts a new frame). false at the end of the recording
+  bool read(cv::Mat& strip, int& row, uint64_t& stamp_ns);
+
+private:
+  RawFrameSource source_;
+  int strip_rows_;
+  size_t frame_;
+  int row_;
+};
+
+// true if the path names a raw recording (by extension)
+bool isRawRecording(const std::string& path);
+
+#endif // VP_RAW_H
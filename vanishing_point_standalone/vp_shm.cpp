@@ -0,0 +1,118 @@
+/**
+ * @file vp_shm.cpp
+ * @brief Latest vanishing point result in POSIX shared memory, guarded by a seqlock
+ */
+
+#include "vp_shm.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(sizeof(VPShmData) % sizeof(uint64_t) == 0, "VPShmData must be a whole number of words");
+
+/* ---------------------------------- Writer ----------------------------------*/
+VPShmWriter::VPShmWriter() : seg_(NULL) { name_[0] = 0; }
+
+VPShmWriter::~VPShmWriter()
+{
+  if (!seg_) return;
+  munmap(seg_, sizeof(VPShmSegment));
+  shm_unlink(name_);
+}
+
+bool VPShmWriter::open(const char* name)
+{
+  if (!std::atomic<uint64_t>().is_lock_free())
+  {
+    fprintf(stderr, "vp_shm: 64 bit atomics are not lock free on this platform\n");
+    return false;
+  }
+
+  int fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+  if (fd < 0) { perror("vp_shm: shm_open"); return false; }
+  if (ftruncate(fd, sizeof(VPShmSegment)) < 0) { perror("vp_shm: ftruncate"); close(fd); return false; }
+  void* p = mmap(NULL, sizeof(VPShmSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) { perror("vp_shm: mmap"); return false; }
+
+  seg_ = static_cast<VPShmSegment*>(p);
+  strncpy(name_, name, sizeof(name_) - 1);
+  name_[sizeof(name_) - 1] = 0;
+
+  // nothing published yet: seq 0. readers check the magic before trusting the layout
+  seg_->seq.store(0, std::memory_order_relaxed);
+  seg_->version = VPShmSegment::VERSION;
+  std::atomic_thread_fence(std::memory_order_release);
+  seg_->magic = VPShmSegment::MAGIC;
+  return true;
+}
+
+void VPShmWriter::write(const VPShmData& data)
+{
+  if (!seg_) return;
+  uint64_t words[VPShmSegment::N_WORDS];
+  memcpy(words, &data, sizeof(data));
+
+  // seqlock: odd while writing, next even value once the data is complete
+  uint32_t s = seg_->seq.load(std::memory_order_relaxed);
+  seg_->seq.store(s + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < VPShmSegment::N_WORDS; i++)
+    seg_->words[i].store(words[i], std::memory_order_relaxed);
+  seg_->seq.store(s + 2, std::memory_order_release);
+}
+
+/* ---------------------------------- Reader ----------------------------------*/
+VPShmReader::VPShmReader() : seg_(NULL) {}
+
+VPShmReader::~VPShmReader()
+{
+  if (seg_) munmap(const_cast<VPShmSegment*>(seg_), sizeof(VPShmSegment));
+}
+
+bool VPShmReader::open(const char* name)
+{
+  int fd = shm_open(name, O_RDONLY, 0);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) < 0 || st.st_size < (off_t) sizeof(VPShmSegment)) { close(fd); return false; }
+  void* p = mmap(NULL, sizeof(VPShmSegment), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED) return false;
+
+  const VPShmSegment* seg = static_cast<const VPShmSegment*>(p);
+  if (seg->magic != VPShmSegment::MAGIC || seg->version != VPShmSegment::VERSION)
+  {
+    munmap(p, sizeof(VPShmSegment));
+    return false;
+  }
+  seg_ = seg;
+  return true;
+}
+
+bool VPShmReader::tryRead(VPShmData& data) const
+{
+  if (!seg_) return false;
+  uint32_t s1 = seg_->seq.load(std::memory_order_acquire);
+  if (s1 == 0 || (s1 & 1)) return false;
+
+  uint64_t words[VPShmSegment::N_WORDS];
+  for (int i = 0; i < VPShmSegment::N_WORDS; i++)
+    words[i] = seg_->words[i].load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (seg_->seq.load(std::memory_order_relaxed) != s1) return false;
+
+  memcpy(&data, words, sizeof(data));
+  return true;
+}
+
+bool VPShmReader::read(VPShmData& data, int max_tries) const
+{
+  if (!seg_ || seg_->seq.load(std::memory_order_acquire) == 0) return false;
+  for (int i = 0; i < max_tries; i++)
+    if (tryRead(data)) return true;
+  return false;
+}
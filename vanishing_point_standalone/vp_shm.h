@@ -0,0 +1,81 @@
+/**
+ * @file vp_shm.h
+ * @brief Latest vanishing point result in POSIX shared memory, guarded by a seqlock.
+ *
+ * One writer (the detector) overwrites a single slot every frame; any number of readers
+ * on the same machine poll it without syscalls or locks. No OpenCV dependency so the
+ * controller can link vp_shm alone.
+ */
+
+#ifndef VP_SHM_H
+#define VP_SHM_H
+
+#include <atomic>
+#include <stdint.h>
+
+#define VP_SHM_NAME "/vanishing_point"
+
+/* ---------------------------------- Data ----------------------------------*/
+struct VPShmData
+{
+  int32_t vp_x, vp_y; // raw vanishing point
+  int32_t vp_filter_x, vp_filter_y; // low pass filtered vanishing point
+  int32_t mid_x, mid_y; // middle point
+  int32_t error; // vp_filter.x - center_x (px)
+  int32_t quality; // VPQuality: 0 full, 1 degraded, 2 predicted
+  uint64_t frame_stamp; // capture time of the frame (ns)
+  uint64_t frame_seq; // sequence number of the frame, increases by one per result
+};
+
+/* ---------------------------------- Segment ----------------------------------*/
+// layout of the shared memory segment. the data is copied in and out as relaxed atomic
+// words so the seqlock is free of data races
+struct VPShmSegment
+{
+  enum { MAGIC = 0x56505348, VERSION = 1, N_WORDS = sizeof(VPShmData) / sizeof(uint64_t) };
+
+  uint32_t magic;
+  uint32_t version;
+  std::atomic<uint32_t> seq; // odd while the writer is updating the data
+  std::atomic<uint64_t> words[N_WORDS];
+};
+
+/* ---------------------------------- Writer ----------------------------------*/
+class VPShmWriter
+{
+public:
+  VPShmWriter();
+  ~VPShmWriter(); // unmaps and unlinks the segment
+
+  // create (or take over) the segment. returns false on failure
+  bool open(const char* name = VP_SHM_NAME);
+  // publish a result. never blocks
+  void write(const VPShmData& data);
+
+private:
+  VPShmSegment* seg_;
+  char name_[64];
+};
+
+/* ---------------------------------- Reader ----------------------------------*/
+class VPShmReader
+{
+public:
+  VPShmReader();
+  ~VPShmReader();
+
+  // map an existing segment read only. returns false if there is none (yet)
+  bool open(const char* name = VP_SHM_NAME);
+  // single attempt, wait-free: false if nothing was published yet or the writer was
+  // mid-update (just poll again)
+  bool tryRead(VPShmData& data) const;
+  // retries up to max_tries times for a consistent copy (the writer holds the slot for
+  // ~100 ns, 1000 tries is tens of us). false if nothing was published yet or the slot
+  // stayed busy, e.g. the writer died mid-update
+  bool read(VPShmData& data, int max_tries = 1000) const;
+
+private:
+  const VPShmSegment* seg_;
+};
+
+#endif // VP_SHM_H
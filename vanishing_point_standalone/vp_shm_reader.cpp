@@ -0,0 +1,38 @@
+/**
+ * @file vp_shm_reader.cpp
+ * @brief Demo consumer of the shared memory output (the shm counterpart of listener.cpp)
+ *
+ * usage: ./vp_shm_reader [name]   (default /vanishing_point, as written by ./vp --shm)
+ */
+
+#include "vp_shm.h"
+#include <stdio.h>
+#include <unistd.h>
+
+int main(int argc, char** argv)
+{
+  const char* name = argc > 1 ? argv[1] : VP_SHM_NAME;
+
+  // wait for the detector to create the segment
+  VPShmReader reader;
+  while (!reader.open(name)) usleep(100000);
+
+  // poll the latest result and print each new frame once. a real controller would
+  // just tryRead() once per control period
+  VPShmData data;
+  uint64_t last_seq = 0;
+  for (;;)
+  {
+    if (reader.tryRead(data) && data.frame_seq != last_seq)
+    {
+      if (last_seq && data.frame_seq != last_seq + 1)
+        printf("missed %llu frames\n", (unsigned long long) (data.frame_seq - last_seq - 1));
+      printf("I heard: frame %llu | error: %d | vp_filter: %d,%d | quality: %d\n",
+             (unsigned long long) data.frame_seq, data.error, data.vp_filter_x, data.vp_filter_y, data.quality);
+      last_seq = data.frame_seq;
+    }
+    usleep(1000);
+  }
+
+  return 0;
+}
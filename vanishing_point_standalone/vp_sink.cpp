@@ -0,0 +1,191 @@
+/**
+ * @file vp_sink.cpp
+ * @brief Asynchronous sink for per-frame results and annotated frames
+ */
+
+#include "vp_sink.h"
+#include <ctype.h>
+#include <stdio.h>
+#include <string.h>
+
+using namespace cv;
+using namespace std;
+
+static bool endsWith(const string& s, const string& suffix)
+{
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// a printf pattern with exactly one integer conversion (flags, width, precision, an
+// optional l), "%%" aside. is_long: the conversion has the l
+static bool framePattern(const string& s, bool& is_long)
+{
+  int conversions = 0;
+  for (size_t i = 0; i < s.size(); i++)
+  {
+    if (s[i] != '%') continue;
+    if (++i < s.size() && s[i] == '%') continue;
+    while (i < s.size() && strchr("-+ #0", s[i])) i++;
+    while (i < s.size() && (isdigit(s[i]) || s[i] == '.')) i++;
+    is_long = i < s.size() && s[i] == 'l';
+    if (is_long) i++;
+    if (i >= s.size() || !strchr("diouxX", s[i])) return false;
+    conversions++;
+  }
+  return conversions == 1;
+}
+
+/* ---------------------------------- Sink ----------------------------------*/
+ResultSink::ResultSink(const string& log_path, const string& frames_path, size_t max_queue, size_t max_frames)
+  : log_buffer_(1 << 16), binary_(endsWith(log_path, ".bin")), frames_path_(frames_path),
+    video_(endsWith(frames_path, ".avi")), long_index_(false), recording_(!frames_path.empty()),
+    max_queue_(max_queue), max_frames_(max_frames), queued_frames_(0), dropped_(0), stop_(false)
+{
+  if (recording_ && !video_ && !framePattern(frames_path_, long_index_))
+  {
+    fprintf(stderr, "vp_sink: %s is neither an .avi nor a png pattern with one integer conversion "
+                    "(e.g. frames/image_%%06lu.png), not recording\n", frames_path_.c_str());
+    recording_ = false;
+  }
+
+  if (!log_path.empty())
+  {
+    // large stream buffer: the worker only hits the disk every 64k
+    log_.rdbuf()->pubsetbuf(&log_buffer_[0], log_buffer_.size());
+    log_.open(log_path.c_str(), binary_ ? ios::out | ios::binary : ios::out);
+    if (!log_.is_open())
+      perror(("vp_sink: " + log_path).c_str());
+    else if (!binary_)
+      log_ << "frame,stamp,vp_x,vp_y,vp_filter_x,vp_filter_y,mid_x,error,inliers,n_lines,quality,age\n";
+  }
+
+  // png sequence: fastest compression, these are for review not for archiving
+  compression_params_.push_back(CV_IMWRITE_PNG_COMPRESSION);
+  compression_params_.push_back(1);
+
+  worker_ = thread(&ResultSink::run, this);
+}
+
+ResultSink::~ResultSink()
+{
+  {
+    lock_guard<mutex> lock(mutex_);
+    stop_ = true;
+  }
+  cond_.notify_one();
+  worker_.join();
+  if (video_) writer_.release();
+}
+
+bool ResultSink::push(unsigned long ind, double stamp, const VPResult& result, const Mat& annotated)
+{
+  bool complete = true;
+  {
+    lock_guard<mutex> lock(mutex_);
+    if (queue_.size() >= max_queue_)
+    {
+      dropped_++;
+      return false;
+    }
+    queue_.push_back(Item());
+    Item& item = queue_.back();
+    item.ind = ind;
+    item.stamp = stamp;
+    item.result = result;
+    if (recording() && !annotated.empty())
+    {
+      // frames are big, they get a tighter bound than the results
+      if (queued_frames_ < max_frames_)
+      {
+        annotated.copyTo(item.frame);
+        queued_frames_++;
+      }
+      else
+      {
+        dropped_++;
+        complete = false;
+      }
+    }
+  }
+  cond_.notify_one();
+  return complete;
+}
+
+unsigned long ResultSink::dropped() const
+{
+  lock_guard<mutex> lock(mutex_);
+  return dropped_;
+}
+
+/* ---------------------------------- worker ----------------------------------*/
+void ResultSink::run()
+{
+  Item item;
+  for (;;)
+  {
+    {
+      unique_lock<mutex> lock(mutex_);
+      while (queue_.empty() && !stop_) cond_.wait(lock);
+      if (queue_.empty()) break; // stopped and drained
+      item = queue_.front();
+      queue_.pop_front();
+    }
+    write(item);
+    if (!item.frame.empty())
+    {
+      lock_guard<mutex> lock(mutex_);
+      queued_frames_--;
+    }
+  }
+  if (log_.is_open()) log_.flush();
+}
+
+void ResultSink::write(const Item& item)
+{
+  const VPResult& r = item.result;
+  if (log_.is_open())
+  {
+    if (binary_)
+    {
+      Record rec;
+      rec.ind = item.ind;
+      rec.stamp = item.stamp;
+      rec.vp_x = r.vp.x; rec.vp_y = r.vp.y;
+      rec.vp_filter_x = r.vp_filter.x; rec.vp_filter_y = r.vp_filter.y;
+      rec.mid_x = r.mid.x;
+      rec.error = r.error; rec.inliers = r.inliers; rec.n_lines = r.n_lines;
+      rec.quality = r.quality; rec.age = r.age;
+      log_.write(reinterpret_cast<const char*>(&rec), sizeof(rec));
+    }
+    else
+    {
+      log_ << item.ind << "," << item.stamp << "," << r.vp.x << "," << r.vp.y << ","
+           << r.vp_filter.x << "," << r.vp_filter.y << "," << r.mid.x << "," << r.error << ","
+           << r.inliers << "," << r.n_lines << "," << r.quality << "," << r.age << "\n";
+    }
+  }
+
+  if (item.frame.empty() || !recording_) return;
+  if (video_)
+  {
+    if (!writer_.isOpened())
+    {
+      writer_.open(frames_path_, CV_FOURCC('M','J','P','G'), 25, item.frame.size(), item.frame.channels() == 3);
+      // codec or path not available: say so once, push() stops queueing frames
+      if (!writer_.isOpened())
+      {
+        fprintf(stderr, "vp_sink: could not open video %s, not recording\n", frames_path_.c_str());
+        recording_ = false;
+        return;
+      }
+    }
+    writer_ << item.frame;
+  }
+  else
+  {
+    char str[256];
+    if (long_index_) snprintf(str, sizeof(str), frames_path_.c_str(), item.ind);
+    else snprintf(str, sizeof(str), frames_path_.c_str(), static_cast<int>(item.ind));
+    imwrite(str, item.frame, compression_params_);
+  }
+}
@@ -0,0 +1,88 @@
+/**
+ * @file vp_sink.h
+ * @brief Asynchronous sink for per-frame results and annotated frames
+ */
+
+#ifndef VP_SINK_H
+#define VP_SINK_H
+
+#include "opencv2/core/core.hpp"
+#include "opencv2/highgui/highgui.hpp"
+#include "vp_detector.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/* ---------------------------------- Sink ----------------------------------*/
+// results and frames are queued by the detection loop and written by a worker thread.
+// the queue is bounded: when it is full the item is dropped (and counted), push() never
+// waits on disk or the encoder.
+//   log_path: "*.bin" for fixed size binary records, csv otherwise. empty = no log
+//   frames_path: "*.avi" to encode a video (MJPG), otherwise a printf pattern for a png
+//                sequence with one integer conversion for the frame index, e.g.
+//                "frames/image_%06lu.png". empty = no frames. a pattern without exactly
+//                one integer conversion, or a video that cannot be opened, is reported
+//                and recording is turned off
+class ResultSink
+{
+public:
+  ResultSink(const std::string& log_path, const std::string& frames_path,
+             size_t max_queue = 256, size_t max_frames = 8);
+  ~ResultSink(); // drains the queue
+
+  // queue the result of frame ind (stamp in seconds). annotated is copied, pass an empty
+  // Mat to skip it. returns false if the item (or its frame) was dropped
+  bool push(unsigned long ind, double stamp, const VPResult& result, const cv::Mat& annotated);
+
+  bool logging() const { return log_.is_open(); }
+  bool recording() const { return recording_; }
+  unsigned long dropped() const;
+
+private:
+  struct Item
+  {
+    unsigned long ind;
+    double stamp;
+    VPResult result;
+    cv::Mat frame;
+  };
+
+  // binary log record
+  struct Record
+  {
+    uint64_t ind;
+    double stamp;
+    int32_t vp_x, vp_y, vp_filter_x, vp_filter_y, mid_x;
+    int32_t error, inliers, n_lines, quality, age;
+  };
+
+  void run();
+  void write(const Item&);
+
+  std::vector<char> log_buffer_; // log_'s stream buffer, declared first so it outlives log_
+  std::ofstream log_;
+  bool binary_;
+  std::string frames_path_;
+  bool video_;
+  bool long_index_; // pattern takes an unsigned long (%lu), an int otherwise
+  std::atomic<bool> recording_; // turned off by the worker if the video cannot be opened
+  cv::VideoWriter writer_;
+  std::vector<int> compression_params_;
+
+  size_t max_queue_, max_frames_;
+  std::deque<Item> queue_;
+  size_t queued_frames_;
+  unsigned long dropped_;
+  bool stop_;
+  mutable std::mutex mutex_;
+  std::condition_variable cond_;
+  std::thread worker_;
+};
+
+#endif // VP_SINK_H
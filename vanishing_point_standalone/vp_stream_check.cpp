@@ -0,0 +1,94 @@
+/**
+ * @file vp_stream_check.cpp
+ * @brief Replay a raw recording strip by strip and check the streaming detector against detect()
+ *
+ * usage: ./vp_stream_check <recording.y8> [--strip-rows N]
+ *
+ * one detector gets whole frames, another the same frames as strips of N rows (default 16).
+ * exits with 1 if their lines or vanishing points differ on any frame. also prints the
+ * latency from the last strip to the result next to the whole frame detection time.
+ */
+
+#include "vp_detector.h"
+#include "vp_raw.h"
+#include "vp_time.h"
+#include <iostream>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+
+using namespace cv;
+using namespace std;
+
+// same lines up to float rounding of the hough angles
+static bool sameLines(const vector<Vec2f>& a, const vector<Vec2f>& b)
+{
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++)
+    if (fabs(a[i][0] - b[i][0]) > 1e-3 || fabs(a[i][1] - b[i][1]) > 1e-5) return false;
+  return true;
+}
+
+int main(int argc, char** argv)
+{
+  string filename;
+  int strip_rows = 16;
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "--strip-rows") && i + 1 < argc) strip_rows = atoi(argv[++i]);
+    else filename = argv[i];
+  }
+  RawStripSource strips;
+  if (filename.empty() || !strips.open(filename, strip_rows))
+  {
+    cerr << "usage: " << argv[0] << " <recording.y8> [--strip-rows N]" << endl;
+    return 1;
+  }
+  const RawFrameSource& frames = strips.frames();
+
+  VanishingPointDetector whole, streamed;
+  Mat strip;
+  int row;
+  uint64_t stamp;
+  uint64_t t_whole = 0, t_last_strip = 0, t_estimate = 0;
+  unsigned long n = 0, failed = 0;
+  while (strips.read(strip, row, stamp))
+  {
+    if (row == 0) streamed.beginFrame(Size(frames.width(), frames.height()));
+
+    VPResult result;
+    uint64_t start = now_ns();
+    if (!streamed.pushStrip(strip, result)) continue;
+    t_last_strip += now_ns() - start;
+    t_estimate += result.ransac_ns;
+
+    VPResult reference;
+    whole.detect(frames.frame(n), reference);
+    t_whole += reference.total_ns;
+
+    if (!sameLines(whole.lines(), streamed.lines()) || reference.found != result.found || reference.vp != result.vp)
+    {
+      cout << "frame " << n << ": " << whole.lines().size() << " lines, vp " << reference.vp.x << "," << reference.vp.y
+           << " | streamed: " << streamed.lines().size() << " lines, vp " << result.vp.x << "," << result.vp.y << endl;
+      failed++;
+    }
+    n++;
+  }
+  if (n == 0)
+  {
+    cerr << "No frames in " << filename << endl;
+    return 1;
+  }
+
+  cout << "Frames: " << n << " | strips of " << strip_rows << " rows" << endl;
+  cout << "whole frame: " << t_whole / n / 1000 << " us | last strip to result: " << t_last_strip / n / 1000
+       << " us (estimator " << t_estimate / n / 1000 << " us)" << endl;
+  if (failed)
+  {
+    cout << "FAILED: " << failed << "/" << n << " frames differ" << endl;
+    return 1;
+  }
+  cout << "OK" << endl;
+  return 0;
+}
@@ -0,0 +1,342 @@
+/**
+ * @file vp_sweep.cpp
+ * @brief Parallel parameter sweep of the vanishing point detector over recorded footage.
+ *
+ * Every configuration is run over the same decoded frames and scored on per-frame
+ * latency and on accuracy: mean distance to labelled vanishing points when a label
+ * file is given, frame to frame vp jitter otherwise. All configurations are written
+ * as csv and the pareto front (latency / accuracy / detection rate) is printed.
+ *
+ * accuracy is scored on T threads at once, with opencv kept single threaded. latency is
+ * then timed one config at a time so it is not measured under contention, on a subsample
+ * of evenly spaced frames (--latency-frames, default 100, 0 = all) to bound that pass.
+ *
+ * usage: ./vp_sweep <video|recording.y8> [--random N] [--seed S] [--threads T] [--frames N]
+ *                           [--latency-frames N] [--labels labels.csv] [--out sweep.csv]
+ * labels.csv: one "frame,x,y" line per labelled frame (frame index from 0)
+ */
+
+#include "opencv2/highgui/highgui.hpp"
+#include "opencv2/imgproc/imgproc.hpp"
+#include "vp_detector.h"
+#include "vp_raw.h"
+#include "vp_time.h"
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <thread>
+#include <time.h>
+#include <vector>
+
+using namespace cv;
+using namespace std;
+
+/* ---------------------------------- Search space ----------------------------------*/
+// candidate values per parameter. the grid is their cartesian product, random search
+// draws uniformly from [front, back] of each list
+static const int lowThreshold_vals[]     = { 40, 60, 80 };
+static const int ratio_vals[]            = { 2, 3 };
+static const int s_trackbar_vals[]       = { 10, 30, 50 };
+static const int min_threshold_vals[]    = { 50 };
+static const int N_iterations_vals[]     = { 25, 50, 100 };
+static const int threshold_ransac_vals[] = { 5, 10, 15 };
+static const int vertical_cutoff_vals[]  = { 5, 10 };
+// hough controller band [line_band/4, line_band], 0 = fixed threshold
+static const int line_band_vals[]        = { 0, 20, 40 };
+// line nms rho tolerance (theta tolerance stays at the default), 0 = off
+static const int nms_rho_vals[]          = { 0, 10 };
+// line count below which the voting estimator replaces ransac, 0 = always ransac
+static const int vote_max_lines_vals[]   = { 0, 40 };
+
+#define N_VALS(a) (sizeof(a)/sizeof(a[0]))
+
+struct Score
+{
+  VPParams params;
+  double latency_mean; // ns per frame
+  double latency_p95;
+  double accuracy; // label error (px) if labels are given, jitter (px/frame) otherwise
+  double detection_rate; // fraction of frames with a vp
+  bool pareto;
+};
+
+/* -------------------------------------- configs --------------------------------------------*/
+vector<VPParams> gridConfigs()
+{
+  vector<VPParams> configs;
+  VPParams p;
+  for (size_t a = 0; a < N_VALS(lowThreshold_vals); a++)
+  for (size_t b = 0; b < N_VALS(ratio_vals); b++)
+  for (size_t c = 0; c < N_VALS(s_trackbar_vals); c++)
+  for (size_t d = 0; d < N_VALS(min_threshold_vals); d++)
+  for (size_t e = 0; e < N_VALS(N_iterations_vals); e++)
+  for (size_t f = 0; f < N_VALS(threshold_ransac_vals); f++)
+  for (size_t g = 0; g < N_VALS(vertical_cutoff_vals); g++)
+  for (size_t h = 0; h < N_VALS(line_band_vals); h++)
+  for (size_t k = 0; k < N_VALS(nms_rho_vals); k++)
+  for (size_t l = 0; l < N_VALS(vote_max_lines_vals); l++)
+  {
+    p.lowThreshold = lowThreshold_vals[a];
+    p.ratio = ratio_vals[b];
+    p.s_trackbar = s_trackbar_vals[c];
+    p.min_threshold = min_threshold_vals[d];
+    p.N_iterations = N_iterations_vals[e];
+    p.threshold_ransac = threshold_ransac_vals[f];
+    p.vertical_cutoff = vertical_cutoff_vals[g];
+    p.line_band_max = line_band_vals[h];
+    p.line_band_min = p.line_band_max / 4;
+    p.nms_rho = nms_rho_vals[k];
+    p.vote_max_lines = vote_max_lines_vals[l];
+    configs.push_back(p);
+  }
+  return configs;
+}
+
+#define UNIFORM(rng, a) (rng).uniform((a)[0], (a)[N_VALS(a)-1] + 1)
+
+vector<VPParams> randomConfigs(int n, uint64_t seed)
+{
+  vector<VPParams> configs;
+  RNG rng(seed);
+  VPParams p;
+  for (int i = 0; i < n; i++)
+  {
+    p.lowThreshold = UNIFORM(rng, lowThreshold_vals);
+    p.ratio = UNIFORM(rng, ratio_vals);
+    p.s_trackbar = UNIFORM(rng, s_trackbar_vals);
+    p.min_threshold = UNIFORM(rng, min_threshold_vals);
+    p.N_iterations = UNIFORM(rng, N_iterations_vals);
+    p.threshold_ransac = UNIFORM(rng, threshold_ransac_vals);
+    p.vertical_cutoff = UNIFORM(rng, vertical_cutoff_vals);
+    // either off or a band somewhere in the range
+    p.line_band_max = rng.uniform(0, 2) ? UNIFORM(rng, line_band_vals) : 0;
+    p.line_band_min = p.line_band_max / 4;
+    p.nms_rho = UNIFORM(rng, nms_rho_vals);
+    p.vote_max_lines = rng.uniform(0, 2) ? UNIFORM(rng, vote_max_lines_vals) : 0;
+    configs.push_back(p);
+  }
+  return configs;
+}
+
+/* -------------------------------------- evaluate --------------------------------------------*/
+// run one configuration over all frames, accuracy and detection rate
+void evaluate(const vector<Mat>& frames, const map<int, Point>& labels, Score& score)
+{
+  VanishingPointDetector detector(score.params);
+  VPResult result;
+
+  // undetected labelled frames count as the worst possible error
+  const double miss_error = sqrt(pow(score.params.width, 2.0) + pow(score.params.height, 2.0));
+  double label_error = 0, jitter = 0;
+  int detected = 0, n_jitter = 0;
+  bool prev_found = false;
+  Point prev;
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    detector.detect(frames[i], result);
+
+    if (result.found)
+    {
+      detected++;
+      if (prev_found)
+      {
+        jitter += norm(result.vp_filter - prev);
+        n_jitter++;
+      }
+      prev = result.vp_filter;
+    }
+    prev_found = result.found;
+
+    map<int, Point>::const_iterator it = labels.find(static_cast<int>(i));
+    if (it != labels.end())
+      label_error += result.found ? norm(result.vp - it->second) : miss_error;
+  }
+
+  score.detection_rate = frames.empty() ? 0 : (double) detected / frames.size();
+  if (!labels.empty())
+    score.accuracy = label_error / labels.size();
+  else
+    score.accuracy = n_jitter ? jitter / n_jitter : miss_error;
+}
+
+// run one configuration over the latency subsample, per-frame latency
+void measureLatency(const vector<Mat>& frames, Score& score)
+{
+  VanishingPointDetector detector(score.params);
+  VPResult result;
+  vector<uint64_t> latency(frames.size());
+
+  for (size_t i = 0; i < frames.size(); i++)
+  {
+    uint64_t start = now_ns();
+    detector.detect(frames[i], result);
+    latency[i] = now_ns() - start;
+  }
+
+  uint64_t sum = 0;
+  for (size_t i = 0; i < latency.size(); i++) sum += latency[i];
+  score.latency_mean = frames.empty() ? 0 : (double) sum / frames.size();
+  sort(latency.begin(), latency.end());
+  score.latency_p95 = latency.empty() ? 0 : latency[(latency.size() - 1) * 95 / 100];
+}
+
+/* -------------------------------------- pareto front --------------------------------------------*/
+// a dominates b if it is no worse on every objective and better on at least one
+bool dominates(const Score& a, const Score& b)
+{
+  bool no_worse = a.latency_mean <= b.latency_mean && a.accuracy <= b.accuracy && a.detection_rate >= b.detection_rate;
+  bool better = a.latency_mean < b.latency_mean || a.accuracy < b.accuracy || a.detection_rate > b.detection_rate;
+  return no_worse && better;
+}
+
+void markPareto(vector<Score>& scores)
+{
+  for (size_t i = 0; i < scores.size(); i++)
+  {
+    scores[i].pareto = true;
+    for (size_t j = 0; j < scores.size() && scores[i].pareto; j++)
+      if (j != i && dominates(scores[j], scores[i])) scores[i].pareto = false;
+  }
+}
+
+bool byLatency(const Score& a, const Score& b) { return a.latency_mean < b.latency_mean; }
+
+/* -------------------------------------- output --------------------------------------------*/
+void writeScore(ostream& os, const Score& s)
+{
+  const VPParams& p = s.params;
+  os << p.lowThreshold << "," << p.ratio << "," << p.s_trackbar << "," << p.min_threshold << ","
+     << p.N_iterations << "," << p.threshold_ransac << "," << p.vertical_cutoff << "," << p.line_band_max << "," << p.nms_rho << ","
+     << p.vote_max_lines << ","
+     << s.latency_mean << "," << s.latency_p95 << "," << s.accuracy << "," << s.detection_rate << ","
+     << s.pareto << "\n";
+}
+
+const char* csv_header = "lowThreshold,ratio,s_trackbar,min_threshold,N_iterations,threshold_ransac,"
+                         "vertical_cutoff,line_band_max,nms_rho,vote_max_lines,latency_mean_ns,latency_p95_ns,accuracy,detection_rate,pareto\n";
+
+/* -------------------------------------- main --------------------------------------------*/
+int main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    cerr << "usage: " << argv[0] << " <video> [--random N] [--seed S] [--threads T] [--frames N] [--latency-frames N] "
+         << "[--labels labels.csv] [--out sweep.csv]" << endl;
+    return 1;
+  }
+
+  string filename = argv[1], labels_file, out_file = "sweep.csv";
+  int n_random = 0, max_frames = 0, latency_frames = 100;
+  int n_threads = thread::hardware_concurrency();
+  uint64_t seed = time(NULL);
+  for (int i = 2; i + 1 < argc; i += 2)
+  {
+    if (!strcmp(argv[i], "--random")) n_random = atoi(argv[i+1]);
+    else if (!strcmp(argv[i], "--seed")) seed = strtoull(argv[i+1], NULL, 10);
+    else if (!strcmp(argv[i], "--threads")) n_threads = atoi(argv[i+1]);
+    else if (!strcmp(argv[i], "--frames")) max_frames = atoi(argv[i+1]);
+    else if (!strcmp(argv[i], "--latency-frames")) latency_frames = atoi(argv[i+1]);
+    else if (!strcmp(argv[i], "--labels")) labels_file = argv[i+1];
+    else if (!strcmp(argv[i], "--out")) out_file = argv[i+1];
+    else { cerr << "unknown option " << argv[i] << endl; return 1; }
+  }
+  if (n_threads < 1) n_threads = 1;
+
+  // every configuration runs on the same grayscale frames: views into a raw recording,
+  // or the video decoded once up front
+  vector<Mat> frames;
+  RawFrameSource raw;
+  if (isRawRecording(filename))
+  {
+    if (!raw.open(filename)) return 1;
+    for (size_t i = 0; i < raw.size() && (max_frames <= 0 || static_cast<int>(i) < max_frames); i++)
+      frames.push_back(raw.frame(i));
+  }
+  else
+  {
+    VideoCapture capture(filename);
+    if (!capture.isOpened())
+    {
+      cerr << "Error when reading video " << filename << endl;
+      return 1;
+    }
+    Mat frame, frame_gray;
+    while (max_frames <= 0 || static_cast<int>(frames.size()) < max_frames)
+    {
+      capture >> frame;
+      if (frame.empty()) break;
+      cvtColor(frame, frame_gray, COLOR_RGB2GRAY);
+      frames.push_back(frame_gray.clone());
+    }
+  }
+
+  map<int, Point> labels;
+  if (!labels_file.empty())
+  {
+    ifstream in(labels_file.c_str());
+    int f, x, y; char c1, c2;
+    while (in >> f >> c1 >> x >> c2 >> y) labels[f] = Point(x, y);
+  }
+
+  vector<VPParams> configs = n_random > 0 ? randomConfigs(n_random, seed) : gridConfigs();
+  // image dimensions follow the footage
+  if (!frames.empty())
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+      configs[i].width = frames[0].cols;
+      configs[i].height = frames[0].rows;
+    }
+
+  cout << "Sweeping " << configs.size() << " configs over " << frames.size() << " frames on "
+       << n_threads << " threads" << (labels.empty() ? " (accuracy = jitter)" : " (accuracy = label error)") << endl;
+  if (n_random > 0) cout << "Random configs from seed " << seed << " (--seed " << seed << " to repeat)" << endl;
+
+  // workers pull the next configuration until all are scored. opencv (and the fused
+  // edge kernel) would start its own threads per detect on top of the workers
+  int cv_threads = getNumThreads();
+  setNumThreads(1);
+  vector<Score> scores(configs.size());
+  atomic<size_t> next(0);
+  vector<thread> workers;
+  for (int t = 0; t < n_threads; t++)
+  {
+    workers.push_back(thread([&]() {
+      for (size_t i = next++; i < configs.size(); i = next++)
+      {
+        scores[i].params = configs[i];
+        evaluate(frames, labels, scores[i]);
+      }
+    }));
+  }
+  for (size_t t = 0; t < workers.size(); t++) workers[t].join();
+
+  // latency is timed alone, with opencv threads as in vp, on evenly spaced frames
+  vector<Mat> timed;
+  if (latency_frames <= 0 || latency_frames >= static_cast<int>(frames.size())) timed = frames;
+  else
+    for (int i = 0; i < latency_frames; i++) timed.push_back(frames[i * frames.size() / latency_frames]);
+  cout << "Timing " << configs.size() << " configs on " << timed.size() << " frames" << endl;
+  setNumThreads(cv_threads);
+  for (size_t i = 0; i < scores.size(); i++) measureLatency(timed, scores[i]);
+
+  markPareto(scores);
+  sort(scores.begin(), scores.end(), byLatency);
+
+  ofstream out(out_file.c_str());
+  out << csv_header;
+  for (size_t i = 0; i < scores.size(); i++) writeScore(out, scores[i]);
+
+  cout << "Pareto front:\n" << csv_header;
+  for (size_t i = 0; i < scores.size(); i++)
+    if (scores[i].pareto) writeScore(cout, scores[i]);
+  cout << "All configs written to " << out_file << endl;
+
+  return 0;
+}
@@ -0,0 +1,22 @@
+/**
+ * @file vp_time.h
+ * @brief Monotonic clock shared by the detector, metrics and tools
+ */
+
+#ifndef VP_TIME_H
+#define VP_TIME_H
+
+#include <stdint.h>
+#include <time.h>
+
+#define BILLION 1000000000L
+
+// monotonic time in ns
+inline uint64_t now_ns()
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC, &t);
+  return BILLION * t.tv_sec + t.tv_nsec;
+}
+
+#endif // VP_TIME_H